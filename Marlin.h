@@ -248,6 +248,24 @@ void clear_command_queue();
 extern millis_t previous_cmd_ms;
 inline void refresh_cmd_timeout() { previous_cmd_ms = millis(); }
 
+#if ENABLED(SEGMENT_COALESCING)
+  void flush_coalesced_move(); // Buffer the G0/G1 move being held, if any
+#endif
+
+#if ENABLED(BINARY_MOVE_PROTOCOL)
+  #define BINARY_FRAME_START 0xFE
+
+  inline uint8_t binary_delta_size(const uint8_t flags) { return 1 << ((flags >> 5) & 0x03); }
+
+  // The length of a binary move frame with these flags, or 0 if they are bad
+  inline uint8_t binary_frame_length(const uint8_t flags) {
+    if (TEST(flags, 7) || (flags & 0x60) == 0x60) return 0;
+    uint8_t axes = 0;
+    LOOP_XYZE(i) if (TEST(flags, i)) axes++;
+    return 3 + axes * binary_delta_size(flags) + (TEST(flags, 4) ? 2 : 0) + 2;
+  }
+#endif
+
 #if ENABLED(FAST_PWM_FAN)
   void setPwmFrequency(uint8_t pin, int val);
 #endif
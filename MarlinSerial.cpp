@@ -40,18 +40,100 @@
 
 #if UART_PRESENT(SERIAL_PORT)
   ring_buffer_r rx_buffer  =  { { 0 }, 0, 0 };
+  #if ENABLED(SERIAL_BYTE_CREDITS)
+    volatile uint16_t rx_dropped = 0;
+    #if ENABLED(RX_COMMENT_STRIPPING) || ENABLED(RX_LINE_FRAMING)
+      volatile uint16_t rx_bypassed = 0;
+    #endif
+  #endif
   #if TX_BUFFER_SIZE > 0
     ring_buffer_t tx_buffer  =  { { 0 }, 0, 0 };
     static bool _written;
   #endif
+  #if ENABLED(REALTIME_COMMANDS)
+    bool tx_line_start = true;
+  #endif
+#endif
+
+#if ENABLED(RX_COMMENT_STRIPPING)
+
+  /**
+   * Follow the comment and escape rules of get_serial_commands() and return
+   * true for the characters it would throw away anyway: comments, blank lines
+   * and spaces at the start of a line. The first leading space is kept so a
+   * line holding only spaces and a comment still gets its "ok".
+   */
+  FORCE_INLINE bool rx_strip_char(const unsigned char c) {
+    static bool comment_mode = false, escaped = false, line_start = true, kept = false;
+
+    if (escaped) { // The character after '\' is kept, unless in a comment
+      escaped = false;
+      return comment_mode;
+    }
+    if (c == '\n' || c == '\r') {
+      const bool blank = !kept;
+      comment_mode = kept = false;
+      line_start = true;
+      return blank;
+    }
+    if (c == '\\') escaped = true;
+    else if (c == ';') comment_mode = true;
+    if (comment_mode || (line_start && c == ' ' && kept)) return true;
+    if (c != ' ') line_start = false;
+    kept = true;
+    return false;
+  }
+
 #endif
 
+#if ENABLED(REALTIME_COMMANDS)
+
+  /**
+   * Act on a realtime command character at once.
+   * Return true if the character was one.
+   */
+  FORCE_INLINE bool realtime_command(const unsigned char c) {
+    switch (c) {
+      case REALTIME_STATUS:
+        realtime_status_requested = true; // Reported from idle()
+        return true;
+      case REALTIME_FEED_HOLD:
+        stepper.feed_hold = true;
+        return true;
+      case REALTIME_RESUME:
+        stepper.feed_hold = false;
+        return true;
+    }
+    return false;
+  }
+
+#endif
 
 FORCE_INLINE void store_char(unsigned char c) {
+  #if ENABLED(REALTIME_COMMANDS)
+    if (realtime_command(c)) return;
+  #endif
+
   CRITICAL_SECTION_START;
     uint8_t h = rx_buffer.head;
     uint8_t i = (uint8_t)(h + 1)  & (RX_BUFFER_SIZE - 1);
 
+    #if ENABLED(RX_COMMENT_STRIPPING)
+      if (rx_strip_char(c)) {
+        #if ENABLED(SERIAL_BYTE_CREDITS)
+          rx_bypassed++;
+        #endif
+      }
+      else
+    #endif
+    #if ENABLED(RX_LINE_FRAMING)
+      if (rx_frame_char(c)) {
+        #if ENABLED(SERIAL_BYTE_CREDITS)
+          rx_bypassed++;
+        #endif
+      }
+      else
+    #endif
     // if we should be storing the received character into the location
     // just before the tail (meaning that the head would advance to the
     // current location of the tail), we're about to overflow the buffer
@@ -60,6 +142,10 @@ FORCE_INLINE void store_char(unsigned char c) {
       rx_buffer.buffer[h] = c;
       rx_buffer.head = i;
     }
+    #if ENABLED(SERIAL_BYTE_CREDITS)
+      else if (rx_dropped < 0xFFFF)
+        rx_dropped++;
+    #endif
   CRITICAL_SECTION_END;
 
   #if ENABLED(EMERGENCY_PARSER)
@@ -212,6 +298,9 @@ void MarlinSerial::flush(void) {
 
   void MarlinSerial::write(uint8_t c) {
     _written = true;
+    #if ENABLED(REALTIME_COMMANDS)
+      tx_line_start = (c == '\n');
+    #endif
     CRITICAL_SECTION_START;
       bool emty = (tx_buffer.head == tx_buffer.tail);
     CRITICAL_SECTION_END;
@@ -274,6 +363,9 @@ void MarlinSerial::flush(void) {
 
 #else
   void MarlinSerial::write(uint8_t c) {
+    #if ENABLED(REALTIME_COMMANDS)
+      tx_line_start = (c == '\n');
+    #endif
     while (!TEST(M_UCSRxA, M_UDREx))
       ;
     M_UDRx = c;
@@ -444,6 +536,18 @@ MarlinSerial customizedSerial;
 
   FORCE_INLINE void emergency_parser(unsigned char c) {
 
+    #if ENABLED(BINARY_MOVE_PROTOCOL)
+      // Skip binary move frames, whose bytes could spell out a command.
+      // The start byte is never part of a line.
+      static uint8_t frame_count = 0, frame_length;
+      if (frame_count) {
+        if (++frame_count == 3) frame_length = binary_frame_length(c);
+        if (frame_count >= 3 && frame_count >= frame_length) frame_count = 0;
+        return;
+      }
+      if (c == BINARY_FRAME_START) { frame_count = 1; return; }
+    #endif
+
     static e_parser_state state = state_RESET;
 
     switch (state) {
@@ -113,6 +113,18 @@ struct ring_buffer_r {
 
 #if UART_PRESENT(SERIAL_PORT)
   extern ring_buffer_r rx_buffer;
+  #if ENABLED(SERIAL_BYTE_CREDITS)
+    extern volatile uint16_t rx_dropped; // Characters lost to a full rx_buffer
+    #if ENABLED(RX_COMMENT_STRIPPING) || ENABLED(RX_LINE_FRAMING)
+      extern volatile uint16_t rx_bypassed; // Characters left out of rx_buffer since the last check
+    #endif
+  #endif
+  #if ENABLED(RX_LINE_FRAMING)
+    bool rx_frame_char(const uint8_t c); // Marlin_main.cpp
+  #endif
+  #if ENABLED(REALTIME_COMMANDS)
+    extern bool tx_line_start; // The last character written ended a line
+  #endif
   #if TX_BUFFER_SIZE > 0
     extern ring_buffer_t tx_buffer;
   #endif
@@ -123,6 +135,10 @@ struct ring_buffer_r {
   void emergency_parser(unsigned char c);
 #endif
 
+#if ENABLED(REALTIME_COMMANDS)
+  extern volatile bool realtime_status_requested; // Marlin_main.cpp
+#endif
+
 class MarlinSerial { //: public Stream
 
   public:
@@ -148,6 +148,7 @@
             S<print> T<travel> minimum speeds
             B<minimum segment time>
             X<max X jerk>, Y<max Y jerk>, Z<max Z jerk>, E<max E jerk>
+            J<junction deviation> (Requires JUNCTION_DEVIATION)
  * M206 - Set additional homing offset.
  * M207 - Set Retract Length: S<length>, Feedrate: F<units/min>, and Z lift: Z<distance>. (Requires FWRETRACT)
  * M208 - Set Recover (unretract) Additional (!) Length: S<length> and Feedrate: F<units/min>. (Requires FWRETRACT)
@@ -192,6 +193,12 @@
  * M666 - Set delta endstop adjustment. (Requires DELTA)
  * M605 - Set dual x-carriage movement mode: "M605 S<mode> [X<x_offset>] [R<temp_offset>]". (Requires DUAL_X_CARRIAGE)
  * M851 - Set Z probe's Z offset in current units. (Negative = below the nozzle.)
+ * M801 - Report planner timing: "M801 [R] [D<0|1>]". (Requires PLANNER_PROFILING)
+ * M802 - Report merged G0/G1 segments: "M802 [R]". (Requires SEGMENT_COALESCING)
+ * M803 - Report stepper and temperature interrupt timing: "M803 [R]". (Requires ISR_PROFILING)
+ * M804 - Report how often each command has run: "M804 [R]". (Requires COMMAND_PROFILING)
+ * M805 - Accept binary move frames between G-code lines: "M805 [S<bool>]". (Requires BINARY_MOVE_PROTOCOL)
+ * M806 - Report SD block transfer timing and cache hits: "M806 [R]". (Requires SD_TRANSFER_PROFILING)
  * M907 - Set digital trimpot motor current using axis codes. (Requires a board with digital trimpots)
  * M908 - Control digital trimpot directly. (Requires DAC_STEPPER_CURRENT or DIGIPOTSS_PIN)
  * M909 - Print digipot/DAC current value. (Requires DAC_STEPPER_CURRENT)
@@ -232,6 +239,7 @@
 #include "math.h"
 #include "nozzle.h"
 #include "duration_t.h"
+#include "gcode_number.h"
 #include "types.h"
 
 #if HAS_ABL
@@ -280,6 +288,10 @@
   #include "endstop_interrupts.h"
 #endif
 
+#if ENABLED(BINARY_MOVE_PROTOCOL)
+  #include <util/crc16.h>
+#endif
+
 #if ENABLED(M100_FREE_MEMORY_WATCHER)
   void gcode_M100();
 #endif
@@ -343,11 +355,83 @@ static long gcode_N, gcode_LastN, Stopped_gcode_LastN = 0;
  * (immediate, serial, sd card) and they are processed sequentially by
  * the main loop. The process_next_command function parses the next
  * command and hands off execution to individual handler functions.
+ *
+ * With PARSED_COMMAND_QUEUE the ring holds parsed commands instead, and
+ * commands that have to stay text wait in a smaller ring, command_text.
+ *
+ * With PACKED_COMMAND_QUEUE the commands are packed end to end in a ring
+ * of bytes, each one preceded by its length (including the nul) and a
+ * "send ok" flag in the high bit. A command is never split at the end of
+ * the ring; a zero length there means "continue at the start".
  */
-static char command_queue[BUFSIZE][MAX_CMD_SIZE];
-static uint8_t cmd_queue_index_r = 0, // Ring buffer read position
-               cmd_queue_index_w = 0, // Ring buffer write position
-               commands_in_queue = 0; // Count of commands in the queue
+#if ENABLED(PARSED_COMMAND_QUEUE)
+
+  typedef struct {
+    char command_code;                    // 'G', 'M' or 'T', or 0 if the command is the oldest in command_text
+    uint8_t subcode;                      // The number after a decimal point, as in G38.2
+    uint16_t codenum;
+    uint32_t codes,                       // Bit n is set if letter 'A' + n is in the command
+             values;                      // ...and is followed by a number
+    float value[PARSED_COMMAND_VALUES];   // The numbers, in letter order
+  } parsed_command_t;
+
+  static parsed_command_t command_queue[BUFSIZE];
+  static char command_text[PARSED_COMMAND_TEXT_SLOTS][MAX_CMD_SIZE];
+  static uint8_t command_text_index_r = 0, // The oldest queued text
+                 command_text_index_w = 0, // The next free text slot
+                 command_texts_queued = 0;
+  #if ENABLED(SDSUPPORT)
+    static bool command_save_queued = false; // An M28 or M928 is waiting, so lines after it stay text
+  #endif
+
+  #define COMMAND_QUEUE_HAS_SPACE() (commands_in_queue < BUFSIZE && command_texts_queued < PARSED_COMMAND_TEXT_SLOTS)
+
+#elif ENABLED(PACKED_COMMAND_QUEUE)
+
+  static char command_queue[COMMAND_QUEUE_BYTES];
+
+  #define COMMAND_SEND_OK_BIT 7
+  #define COMMAND_QUEUE_HAS_SPACE() (commands_in_queue < 255 && command_queue_slot() >= 0)
+
+#else
+
+  static char command_queue[BUFSIZE][MAX_CMD_SIZE];
+
+  #define COMMAND_QUEUE_HAS_SPACE() (commands_in_queue < BUFSIZE)
+
+#endif
+#if ENABLED(PACKED_COMMAND_QUEUE)
+  static uint16_t cmd_queue_index_r = 0, // Ring buffer read position
+                  cmd_queue_index_w = 0; // Ring buffer write position
+  static uint8_t commands_in_queue = 0;  // Count of commands in the queue
+
+  /**
+   * Return the position of the next command's length byte, with room for
+   * a full MAX_CMD_SIZE line after it, or -1 if the queue is too full.
+   * The write position never catches up to the read position, so they are
+   * only equal when the queue is empty.
+   */
+  static int16_t command_queue_slot() {
+    const uint16_t r = cmd_queue_index_r, w = cmd_queue_index_w;
+    if (w >= r) { // Free space at the end of the ring and before r
+      if (COMMAND_QUEUE_BYTES - w > MAX_CMD_SIZE) return w;
+      if (r > MAX_CMD_SIZE + 1) return 0;
+    }
+    else if (r - w > MAX_CMD_SIZE + 1) return w;
+    return -1;
+  }
+
+  // Free bytes in the queue, not counting the unused end of the ring
+  static uint16_t command_queue_free_bytes() {
+    if (cmd_queue_index_w >= cmd_queue_index_r)
+      return COMMAND_QUEUE_BYTES - cmd_queue_index_w + cmd_queue_index_r;
+    return cmd_queue_index_r - cmd_queue_index_w;
+  }
+#else
+  static uint8_t cmd_queue_index_r = 0, // Ring buffer read position
+                 cmd_queue_index_w = 0, // Ring buffer write position
+                 commands_in_queue = 0; // Count of commands in the queue
+#endif
 
 /**
  * Current GCode Command
@@ -357,6 +441,23 @@ static char *current_command,      // The command currently being executed
             *current_command_args, // The address where arguments begin
             *seen_pointer;         // Set by code_seen(), used by the code_value functions
 
+#if ENABLED(G38_PROBE_TARGET)
+  static uint8_t current_command_subcode; // The number after the decimal point, as in G38.2
+#endif
+
+#if ENABLED(PARSED_COMMAND_QUEUE)
+  static bool command_is_parsed,  // The current command came from a parsed record, not text
+              seen_has_value;     // Set by code_seen() for parsed commands
+  static float seen_value;        // ...along with the value
+#endif
+
+/**
+ * The parameter letters of the current command, found in one pass by
+ * parse_command_args() so code_seen() doesn't have to search the arguments.
+ */
+static uint32_t codes_seen;                  // Bit n is set if letter 'A' + n is in the arguments
+static uint8_t code_offset['Z' - 'A' + 1];   // Position of the first of each letter in the arguments
+
 /**
  * Next Injected Command pointer. NULL if no commands are being injected.
  * Used by Marlin internally to ensure that commands initiated from within
@@ -364,6 +465,37 @@ static char *current_command,      // The command currently being executed
  */
 static const char *injected_commands_P = NULL;
 
+#if ENABLED(BINARY_MOVE_PROTOCOL)
+
+  /**
+   * Binary Move Frames
+   * After M805 a host may send moves as binary frames between G-code lines:
+   *
+   *   0xFE      Start of frame. Never part of a G-code line.
+   *   seq       Frame number, counting up from 0 after M805
+   *   flags     Bits 0-3: X, Y, Z, E deltas follow
+   *             Bit 4: A feedrate follows
+   *             Bits 5-6: Delta size. 0 = 1 byte, 1 = 2 bytes, 2 = 4 bytes
+   *   deltas    Signed, little-endian, in 1/BINARY_MOVE_UNITS mm
+   *   feedrate  Unsigned 16-bit, little-endian, in mm/m
+   *   crc       CRC-16/XMODEM of seq through feedrate, high byte first
+   *
+   * Each frame is run like a relative G1 once the commands before it are done,
+   * and answered with "ok". A bad frame is answered with an error and
+   * "Resend binary: <seq>". All input up to the next start byte is dropped,
+   * and frames other than the one asked for are ignored until it arrives.
+   */
+  static bool binary_moves_enabled = false,
+              binary_move_pending = false,    // A frame is waiting for the command queue to empty
+              binary_resend_pending = false;  // Ignore frames until the one asked for
+  static uint8_t binary_frame[3 + (NUM_AXIS) * 4 + 2 + 2],
+                 binary_frame_count = 0,      // Bytes of the frame received so far
+                 binary_frame_size,
+                 binary_sequence = 0;         // The next frame number
+  static long binary_position[XYZE];          // Position in BINARY_MOVE_UNITS
+
+#endif
+
 #if ENABLED(INCH_MODE_SUPPORT)
   float linear_unit_factor = 1.0, volumetric_unit_factor = 1.0;
 #endif
@@ -432,6 +564,18 @@ const char axis_codes[NUM_AXIS] = {'X', 'Y', 'Z', 'E'};
 // Number of characters read in the current line of serial input
 static int serial_count = 0;
 
+#if ENABLED(SERIAL_BYTE_CREDITS)
+  // Characters taken from the serial buffer, to be credited with the next "ok"
+  static uint16_t serial_credits = 0;
+
+  // Append the credits to an "ok"
+  void report_serial_credits() {
+    SERIAL_PROTOCOLPGM(" C");
+    SERIAL_PROTOCOL(serial_credits);
+    serial_credits = 0;
+  }
+#endif
+
 // Inactivity shutdown
 millis_t previous_cmd_ms = 0;
 static millis_t max_inactive_time = 0;
@@ -616,7 +760,40 @@ float cartes[XYZ] = { 0 };
   #endif
 #endif
 
-static bool send_ok[BUFSIZE];
+#if ENABLED(PACKED_COMMAND_QUEUE)
+  #define COMMAND_SENDS_OK() TEST(command_queue[cmd_queue_index_r], COMMAND_SEND_OK_BIT)
+  #define COMMAND_SKIP_OK() CBI(command_queue[cmd_queue_index_r], COMMAND_SEND_OK_BIT)
+#else
+  static bool send_ok[BUFSIZE];
+  #define COMMAND_SENDS_OK() send_ok[cmd_queue_index_r]
+  #define COMMAND_SKIP_OK() (send_ok[cmd_queue_index_r] = false)
+#endif
+
+#if ENABLED(RX_LINE_FRAMING)
+  /**
+   * Who may write to the next free queue slot, command_queue[cmd_queue_index_w]
+   */
+  enum RxLineState {
+    RX_LINE_CLOSED, // The main loop
+    RX_LINE_OPEN,   // The serial receive interrupt may start a line there
+    RX_LINE_ACTIVE, // The serial receive interrupt is framing a line there
+    RX_LINE_READY   // A complete line is waiting for get_available_commands()
+  };
+  static volatile uint8_t rx_line_state = RX_LINE_CLOSED; // RxLineState, one byte for atomic access
+
+  /**
+   * Take the next queue slot back from the receive interrupt.
+   * Return false if it has a line there.
+   */
+  inline bool close_rx_line() {
+    CRITICAL_SECTION_START;
+      if (rx_line_state == RX_LINE_OPEN) rx_line_state = RX_LINE_CLOSED;
+    CRITICAL_SECTION_END;
+    return rx_line_state == RX_LINE_CLOSED;
+  }
+
+  inline void commit_rx_line();
+#endif
 
 #if HAS_SERVOS
   Servo servo[NUM_SERVOS];
@@ -814,26 +991,155 @@ void enqueue_and_echo_commands_P(const char* pgcode) {
 }
 
 void clear_command_queue() {
+  #if ENABLED(PACKED_COMMAND_QUEUE)
+    cmd_queue_index_w = 0;
+  #endif
   cmd_queue_index_r = cmd_queue_index_w;
   commands_in_queue = 0;
+  #if ENABLED(PARSED_COMMAND_QUEUE)
+    command_text_index_r = command_text_index_w = command_texts_queued = 0;
+    #if ENABLED(SDSUPPORT)
+      command_save_queued = false;
+    #endif
+  #endif
+  #if ENABLED(BINARY_MOVE_PROTOCOL)
+    binary_move_pending = false;
+  #endif
 }
 
 /**
  * Once a new command is in the ring buffer, call this to commit it
  */
 inline void _commit_command(bool say_ok) {
-  send_ok[cmd_queue_index_w] = say_ok;
-  cmd_queue_index_w = (cmd_queue_index_w + 1) % BUFSIZE;
+  #if ENABLED(PACKED_COMMAND_QUEUE)
+    // The text was written after the slot, which may be at the start of the ring
+    const uint16_t slot = command_queue_slot();
+    if (slot < cmd_queue_index_w && cmd_queue_index_w < COMMAND_QUEUE_BYTES)
+      command_queue[cmd_queue_index_w] = 0;
+    const uint8_t len = strlen(&command_queue[slot + 1]) + 1;
+    command_queue[slot] = say_ok ? len | _BV(COMMAND_SEND_OK_BIT) : len;
+    cmd_queue_index_w = slot + 1 + len;
+  #else
+    send_ok[cmd_queue_index_w] = say_ok;
+    cmd_queue_index_w = (cmd_queue_index_w + 1) % BUFSIZE;
+  #endif
   commands_in_queue++;
 }
 
+#if ENABLED(PARSED_COMMAND_QUEUE)
+
+  /**
+   * Parse a command line into a queue record.
+   * Return false if the command has to be kept as text.
+   */
+  static bool parse_command_record(const char* p, parsed_command_t &record) {
+    // Skip spaces and a line number
+    while (*p == ' ') p++;
+    if (*p == 'N' && NUMERIC_SIGNED(p[1])) {
+      p += 2;
+      while (NUMERIC(*p)) p++;
+      while (*p == ' ') p++;
+    }
+
+    const char command_code = *p++;
+    if (command_code != 'G' && command_code != 'M' && command_code != 'T') return false;
+
+    while (*p == ' ') p++;
+    if (!NUMERIC(*p)) return false;
+    uint16_t codenum = 0;
+    do codenum = codenum * 10 + (*p++ - '0'); while (NUMERIC(*p));
+    uint8_t subcode = 0;
+    if (*p == '.') for (p++; NUMERIC(*p); p++) subcode = subcode * 10 + (*p - '0');
+
+    // Commands that take a string
+    if (command_code == 'M') switch (codenum) {
+      case 28: case 928:
+        #if ENABLED(SDSUPPORT)
+          command_save_queued = true; // Lines after it may have to be saved as they were sent
+        #endif
+      case 0: case 1: case 23: case 30: case 32: case 33: case 117:
+        return false;
+    }
+
+    uint32_t codes = 0, values = 0;
+    uint8_t count = 0;
+    for (;;) {
+      while (*p == ' ') p++;
+      if (!*p || *p == '*') break;
+
+      const uint8_t i = *p++ - 'A';
+      if (i > 'Z' - 'A') return false; // Anything but a parameter letter
+
+      // A number follows the letter as code_has_value() sees it
+      while (*p == ' ') p++;
+      const char *q = p;
+      if (*q == '-' || *q == '+') q++;
+      const char * const digits = q;
+      while (NUMERIC(*q)) q++;
+      const bool has_value = q > digits || (*q == '.' && NUMERIC(q[1]));
+      if (q - digits > 7) return false; // Integers too large for a float's precision
+
+      const uint32_t bit = 1UL << i;
+      if (codes & bit) { // Only the first of a letter counts, as with strchr()
+        if (has_value) parse_float(p);
+        continue;
+      }
+      codes |= bit;
+      if (!has_value) continue;
+      if (count >= PARSED_COMMAND_VALUES) return false;
+
+      // Insert the value in letter order
+      uint8_t n = 0;
+      for (uint32_t below = values & (bit - 1); below; below &= below - 1) n++;
+      for (uint8_t j = count++; j > n; j--) record.value[j] = record.value[j - 1];
+      record.value[n] = parse_float(p);
+      values |= bit;
+    }
+
+    record.command_code = command_code;
+    record.subcode = subcode;
+    record.codenum = codenum;
+    record.codes = codes;
+    record.values = values;
+    return true;
+  }
+
+#endif // PARSED_COMMAND_QUEUE
+
 /**
  * Copy a command directly into the main command buffer, from RAM.
  * Returns true if successfully adds the command
  */
 inline bool _enqueuecommand(const char* cmd, bool say_ok=false) {
-  if (*cmd == ';' || commands_in_queue >= BUFSIZE) return false;
-  strcpy(command_queue[cmd_queue_index_w], cmd);
+  if (*cmd == ';' || !COMMAND_QUEUE_HAS_SPACE()) return false;
+  #if ENABLED(RX_LINE_FRAMING)
+    // A line framed by the receive interrupt came first, so queue it ahead
+    if (!close_rx_line()) {
+      if (rx_line_state == RX_LINE_ACTIVE) return false; // Retry once it's complete
+      commit_rx_line();
+      if (!COMMAND_QUEUE_HAS_SPACE()) return false;
+    }
+  #endif
+  #if ENABLED(PARSED_COMMAND_QUEUE)
+    parsed_command_t &record = command_queue[cmd_queue_index_w];
+    // Lines being saved to SD are written out as they were sent
+    if (
+      #if ENABLED(SDSUPPORT)
+        card.saving || command_save_queued ||
+      #endif
+      !parse_command_record(cmd, record)
+    ) {
+      char * const text = command_text[command_text_index_w];
+      if (cmd != text) strcpy(text, cmd);
+      command_text_index_w = (command_text_index_w + 1) % (PARSED_COMMAND_TEXT_SLOTS);
+      command_texts_queued++;
+      record.command_code = 0;
+    }
+  #elif ENABLED(PACKED_COMMAND_QUEUE)
+    strcpy(&command_queue[command_queue_slot() + 1], cmd);
+  #else
+    strcpy(command_queue[cmd_queue_index_w], cmd);
+  #endif
   _commit_command(say_ok);
   return true;
 }
@@ -964,6 +1270,202 @@ void gcode_line_error(const char* err, bool doFlush = true) {
   serial_count = 0;
 }
 
+#if ENABLED(BINARY_MOVE_PROTOCOL)
+
+  /**
+   * Drop the rest of the input and ask for the expected frame again
+   */
+  void binary_frame_error() {
+    binary_frame_count = 0;
+    binary_resend_pending = true;
+    SERIAL_ERROR_START;
+    SERIAL_ERRORLNPGM(MSG_ERR_BINARY_FRAME);
+    #if ENABLED(SERIAL_BYTE_CREDITS)
+      serial_credits += MYSERIAL.available();
+    #endif
+    MYSERIAL.flush();
+    SERIAL_PROTOCOLPGM(MSG_BINARY_RESEND);
+    SERIAL_PROTOCOLLN((int)binary_sequence);
+  }
+
+  /**
+   * Add a byte to the binary frame. When the frame is complete
+   * and correct, leave it for loop() to run.
+   */
+  void binary_frame_char(const uint8_t c) {
+    binary_frame[binary_frame_count++] = c;
+
+    if (binary_frame_count == 3) {
+      // Get the frame size from the flags
+      binary_frame_size = binary_frame_length(c);
+      if (!binary_frame_size) binary_frame_error();
+    }
+    else if (binary_frame_count > 3 && binary_frame_count == binary_frame_size) {
+      binary_frame_count = 0;
+      uint16_t crc = 0;
+      for (uint8_t i = 1; i < binary_frame_size - 2; i++) crc = _crc_xmodem_update(crc, binary_frame[i]);
+      if (crc != ((uint16_t)binary_frame[binary_frame_size - 2] << 8 | binary_frame[binary_frame_size - 1]))
+        binary_frame_error();
+      else if (binary_frame[1] != binary_sequence) {
+        if (!binary_resend_pending) binary_frame_error();
+      }
+      else {
+        binary_sequence++;
+        binary_resend_pending = false;
+        binary_move_pending = true;
+      }
+    }
+  }
+
+#endif // BINARY_MOVE_PROTOCOL
+
+#if defined(NO_TIMEOUTS) && NO_TIMEOUTS > 0
+  static millis_t last_command_time = 0; // When the last serial command was received
+#endif
+
+/**
+ * Check the line number and checksum of a line from serial,
+ * and act at once on the commands that can't wait in the queue.
+ * Return false if the line has to be dropped.
+ */
+inline bool serial_line_is_valid(char* command) {
+  while (*command == ' ') command++; // skip any leading spaces
+  char* npos = (*command == 'N') ? command : NULL; // Require the N parameter to start the line
+  char* apos = strchr(command, '*');
+
+  if (npos) {
+
+    boolean M110 = strstr_P(command, PSTR("M110")) != NULL;
+
+    if (M110) {
+      char* n2pos = strchr(command + 4, 'N');
+      if (n2pos) npos = n2pos;
+    }
+
+    gcode_N = strtol(npos + 1, NULL, 10);
+
+    if (gcode_N != gcode_LastN + 1 && !M110) {
+      gcode_line_error(PSTR(MSG_ERR_LINE_NO));
+      return false;
+    }
+
+    if (apos) {
+      byte checksum = 0, count = 0;
+      while (command[count] != '*') checksum ^= command[count++];
+
+      if (strtol(apos + 1, NULL, 10) != checksum) {
+        gcode_line_error(PSTR(MSG_ERR_CHECKSUM_MISMATCH));
+        return false;
+      }
+      // if no errors, continue parsing
+    }
+    else {
+      gcode_line_error(PSTR(MSG_ERR_NO_CHECKSUM));
+      return false;
+    }
+
+    gcode_LastN = gcode_N;
+    // if no errors, continue parsing
+  }
+  else if (apos) { // No '*' without 'N'
+    gcode_line_error(PSTR(MSG_ERR_NO_LINENUMBER_WITH_CHECKSUM), false);
+    return false;
+  }
+
+  // Movement commands alert when stopped
+  if (IsStopped()) {
+    char* gpos = strchr(command, 'G');
+    if (gpos) {
+      int codenum = strtol(gpos + 1, NULL, 10);
+      switch (codenum) {
+        case 0:
+        case 1:
+        case 2:
+        case 3:
+          SERIAL_ERRORLNPGM(MSG_ERR_STOPPED);
+          LCD_MESSAGEPGM(MSG_STOPPED);
+          break;
+      }
+    }
+  }
+
+  #if DISABLED(EMERGENCY_PARSER)
+    // If command was e-stop process now
+    if (strcmp(command, "M108") == 0) {
+      wait_for_heatup = false;
+      #if ENABLED(ULTIPANEL)
+        wait_for_user = false;
+      #endif
+    }
+    if (strcmp(command, "M112") == 0) kill(PSTR(MSG_KILLED));
+    if (strcmp(command, "M410") == 0) { quickstop_stepper(); }
+  #endif
+
+  return true;
+}
+
+#if ENABLED(RX_LINE_FRAMING)
+
+  /**
+   * Called by the serial receive interrupt for each character. While the
+   * next queue slot is open and rx_buffer is empty, frame lines right in the
+   * slot, following the same rules as get_serial_commands().
+   * Return false to put the character in rx_buffer instead.
+   */
+  bool rx_frame_char(const uint8_t c) {
+    static uint8_t count;
+    static bool comment_mode, escaped;
+
+    if (rx_line_state == RX_LINE_OPEN) {
+      if (rx_buffer.head != rx_buffer.tail) return false; // Older characters come first
+      if (c == '\n' || c == '\r') return true;           // Skip empty lines
+      count = 0;
+      comment_mode = escaped = false;
+      rx_line_state = RX_LINE_ACTIVE;
+    }
+    else if (rx_line_state != RX_LINE_ACTIVE)
+      return false;
+
+    char * const line = command_queue[cmd_queue_index_w];
+    if (escaped) {
+      escaped = false;
+      if (!comment_mode) line[count++] = c;
+    }
+    else if (c == '\n' || c == '\r') {
+      if (count) {
+        line[count] = '\0';
+        rx_line_state = RX_LINE_READY;
+      }
+      else // Only a comment
+        rx_line_state = RX_LINE_OPEN;
+    }
+    else if (count >= MAX_CMD_SIZE - 1) {
+      // Ignore characters beyond the max length
+    }
+    else if (c == '\\')
+      escaped = true;
+    else {
+      if (c == ';') comment_mode = true;
+      if (!comment_mode) line[count++] = c;
+    }
+    return true;
+  }
+
+  /**
+   * Check and commit a line framed by the receive interrupt
+   */
+  inline void commit_rx_line() {
+    if (serial_line_is_valid(command_queue[cmd_queue_index_w])) {
+      #if defined(NO_TIMEOUTS) && NO_TIMEOUTS > 0
+        last_command_time = millis();
+      #endif
+      _commit_command(true);
+    }
+    rx_line_state = RX_LINE_CLOSED;
+  }
+
+#endif // RX_LINE_FRAMING
+
 inline void get_serial_commands() {
   static char serial_line_buffer[MAX_CMD_SIZE];
   static boolean serial_comment_mode = false;
@@ -971,7 +1473,6 @@ inline void get_serial_commands() {
   // If the command buffer is empty for too long,
   // send "wait" to indicate Marlin is still waiting.
   #if defined(NO_TIMEOUTS) && NO_TIMEOUTS > 0
-    static millis_t last_command_time = 0;
     millis_t ms = millis();
     if (commands_in_queue == 0 && !MYSERIAL.available() && ELAPSED(ms, last_command_time + NO_TIMEOUTS)) {
       SERIAL_ECHOLNPGM(MSG_WAIT);
@@ -979,13 +1480,55 @@ inline void get_serial_commands() {
     }
   #endif
 
+  #if ENABLED(SERIAL_BYTE_CREDITS)
+    // Report characters lost to a full receive buffer
+    static uint16_t rx_dropped_reported = 0;
+    CRITICAL_SECTION_START;
+      const uint16_t dropped = rx_dropped;
+      #if ENABLED(RX_COMMENT_STRIPPING) || ENABLED(RX_LINE_FRAMING)
+        serial_credits += rx_bypassed; // Characters that never reached the buffer
+        rx_bypassed = 0;
+      #endif
+    CRITICAL_SECTION_END;
+    if (dropped != rx_dropped_reported) {
+      rx_dropped_reported = dropped;
+      SERIAL_ERROR_START;
+      SERIAL_ERRORPGM(MSG_ERR_RX_DROPPED);
+      SERIAL_ERRORLN(dropped);
+    }
+  #endif
+
   /**
    * Loop while serial characters are incoming and the queue is not full
    */
-  while (commands_in_queue < BUFSIZE && MYSERIAL.available() > 0) {
+  while (COMMAND_QUEUE_HAS_SPACE() && MYSERIAL.available() > 0) {
+
+    #if ENABLED(BINARY_MOVE_PROTOCOL)
+      if (binary_move_pending) break; // Read on after the frame has run
+    #endif
 
     char serial_char = MYSERIAL.read();
 
+    #if ENABLED(SERIAL_BYTE_CREDITS)
+      serial_credits++;
+    #endif
+
+    #if ENABLED(BINARY_MOVE_PROTOCOL)
+      // A frame can start wherever a line can
+      if (binary_frame_count || (binary_moves_enabled && !serial_count && !serial_comment_mode && (uint8_t)serial_char == BINARY_FRAME_START)) {
+        binary_frame_char(serial_char);
+        continue;
+      }
+      // After a bad frame, drop the rest of it and anything sent behind it
+      // until a start byte, so none of it gets into a line
+      if (binary_resend_pending) {
+        serial_count = 0;
+        serial_comment_mode = false;
+        if ((uint8_t)serial_char == BINARY_FRAME_START) binary_frame_char(serial_char);
+        continue;
+      }
+    #endif
+
     /**
      * If the character ends the line
      */
@@ -998,79 +1541,7 @@ inline void get_serial_commands() {
       serial_line_buffer[serial_count] = 0; // terminate string
       serial_count = 0; //reset buffer
 
-      char* command = serial_line_buffer;
-
-      while (*command == ' ') command++; // skip any leading spaces
-      char* npos = (*command == 'N') ? command : NULL; // Require the N parameter to start the line
-      char* apos = strchr(command, '*');
-
-      if (npos) {
-
-        boolean M110 = strstr_P(command, PSTR("M110")) != NULL;
-
-        if (M110) {
-          char* n2pos = strchr(command + 4, 'N');
-          if (n2pos) npos = n2pos;
-        }
-
-        gcode_N = strtol(npos + 1, NULL, 10);
-
-        if (gcode_N != gcode_LastN + 1 && !M110) {
-          gcode_line_error(PSTR(MSG_ERR_LINE_NO));
-          return;
-        }
-
-        if (apos) {
-          byte checksum = 0, count = 0;
-          while (command[count] != '*') checksum ^= command[count++];
-
-          if (strtol(apos + 1, NULL, 10) != checksum) {
-            gcode_line_error(PSTR(MSG_ERR_CHECKSUM_MISMATCH));
-            return;
-          }
-          // if no errors, continue parsing
-        }
-        else {
-          gcode_line_error(PSTR(MSG_ERR_NO_CHECKSUM));
-          return;
-        }
-
-        gcode_LastN = gcode_N;
-        // if no errors, continue parsing
-      }
-      else if (apos) { // No '*' without 'N'
-        gcode_line_error(PSTR(MSG_ERR_NO_LINENUMBER_WITH_CHECKSUM), false);
-        return;
-      }
-
-      // Movement commands alert when stopped
-      if (IsStopped()) {
-        char* gpos = strchr(command, 'G');
-        if (gpos) {
-          int codenum = strtol(gpos + 1, NULL, 10);
-          switch (codenum) {
-            case 0:
-            case 1:
-            case 2:
-            case 3:
-              SERIAL_ERRORLNPGM(MSG_ERR_STOPPED);
-              LCD_MESSAGEPGM(MSG_STOPPED);
-              break;
-          }
-        }
-      }
-
-      #if DISABLED(EMERGENCY_PARSER)
-        // If command was e-stop process now
-        if (strcmp(command, "M108") == 0) {
-          wait_for_heatup = false;
-          #if ENABLED(ULTIPANEL)
-            wait_for_user = false;
-          #endif
-        }
-        if (strcmp(command, "M112") == 0) kill(PSTR(MSG_KILLED));
-        if (strcmp(command, "M410") == 0) { quickstop_stepper(); }
-      #endif
+      if (!serial_line_is_valid(serial_line_buffer)) return;
 
       #if defined(NO_TIMEOUTS) && NO_TIMEOUTS > 0
         last_command_time = ms;
@@ -1087,6 +1558,9 @@ inline void get_serial_commands() {
       if (MYSERIAL.available() > 0) {
         // if we have one more character, copy it over
         serial_char = MYSERIAL.read();
+        #if ENABLED(SERIAL_BYTE_CREDITS)
+          serial_credits++;
+        #endif
         if (!serial_comment_mode) serial_line_buffer[serial_count++] = serial_char;
       }
       // otherwise do nothing
@@ -1118,7 +1592,16 @@ inline void get_serial_commands() {
 
     uint16_t sd_count = 0;
     bool card_eof = card.eof();
-    while (commands_in_queue < BUFSIZE && !card_eof && !stop_buffering) {
+    // Read straight into the queue, or into a free command_text slot to be parsed
+    #if ENABLED(PARSED_COMMAND_QUEUE)
+      #define SD_LINE command_text[command_text_index_w]
+    #elif ENABLED(PACKED_COMMAND_QUEUE)
+      #define SD_LINE (&command_queue[command_queue_slot() + 1])
+    #else
+      #define SD_LINE command_queue[cmd_queue_index_w]
+    #endif
+
+    while (COMMAND_QUEUE_HAS_SPACE() && !card_eof && !stop_buffering) {
       int16_t n = card.get();
       char sd_char = (char)n;
       card_eof = card.eof();
@@ -1141,10 +1624,14 @@ inline void get_serial_commands() {
 
         if (!sd_count) continue; //skip empty lines
 
-        command_queue[cmd_queue_index_w][sd_count] = '\0'; //terminate string
+        SD_LINE[sd_count] = '\0'; //terminate string
         sd_count = 0; //clear buffer
 
-        _commit_command(false);
+        #if ENABLED(PARSED_COMMAND_QUEUE)
+          _enqueuecommand(SD_LINE);
+        #else
+          _commit_command(false);
+        #endif
       }
       else if (sd_count >= MAX_CMD_SIZE - 1) {
         /**
@@ -1154,9 +1641,10 @@ inline void get_serial_commands() {
       }
       else {
         if (sd_char == ';') sd_comment_mode = true;
-        if (!sd_comment_mode) command_queue[cmd_queue_index_w][sd_count++] = sd_char;
+        if (!sd_comment_mode) SD_LINE[sd_count++] = sd_char;
       }
     }
+    #undef SD_LINE
   }
 
 #endif // SDSUPPORT
@@ -1169,6 +1657,14 @@ inline void get_serial_commands() {
  */
 void get_available_commands() {
 
+  #if ENABLED(RX_LINE_FRAMING)
+    // A line framed by the receive interrupt comes before anything else
+    if (!close_rx_line()) {
+      if (rx_line_state == RX_LINE_ACTIVE) return; // Wait for the rest of it
+      commit_rx_line();
+    }
+  #endif
+
   // if any immediate commands remain, don't get other commands yet
   if (drain_injected_commands_P()) return;
 
@@ -1177,9 +1673,17 @@ void get_available_commands() {
   #if ENABLED(SDSUPPORT)
     get_sdcard_commands();
   #endif
+
+  #if ENABLED(RX_LINE_FRAMING)
+    // Let the receive interrupt frame the next line in the queue
+    if (!serial_count && COMMAND_QUEUE_HAS_SPACE()) rx_line_state = RX_LINE_OPEN;
+  #endif
 }
 
 inline bool code_has_value() {
+  #if ENABLED(PARSED_COMMAND_QUEUE)
+    if (command_is_parsed) return seen_has_value;
+  #endif
   int i = 1;
   char c = seen_pointer[i];
   while (c == ' ') c = seen_pointer[++i];
@@ -1189,27 +1693,32 @@ inline bool code_has_value() {
 }
 
 inline float code_value_float() {
-  float ret;
-  char* e = strchr(seen_pointer, 'E');
-  if (e) {
-    *e = 0;
-    ret = strtod(seen_pointer + 1, NULL);
-    *e = 'E';
-  }
-  else
-    ret = strtod(seen_pointer + 1, NULL);
-  return ret;
+  #if ENABLED(PARSED_COMMAND_QUEUE)
+    if (command_is_parsed) return seen_value;
+  #endif
+  const char* p = seen_pointer + 1;
+  return parse_float(p);
 }
 
-inline unsigned long code_value_ulong() { return strtoul(seen_pointer + 1, NULL, 10); }
+inline long code_value_long() {
+  #if ENABLED(PARSED_COMMAND_QUEUE)
+    if (command_is_parsed) return (long)seen_value;
+  #endif
+  return parse_long(seen_pointer + 1);
+}
 
-inline long code_value_long() { return strtol(seen_pointer + 1, NULL, 10); }
+inline unsigned long code_value_ulong() {
+  #if ENABLED(PARSED_COMMAND_QUEUE)
+    if (command_is_parsed) return (unsigned long)(long)seen_value;
+  #endif
+  return parse_ulong(seen_pointer + 1);
+}
 
-inline int code_value_int() { return (int)strtol(seen_pointer + 1, NULL, 10); }
+inline int code_value_int() { return (int)code_value_long(); }
 
-inline uint16_t code_value_ushort() { return (uint16_t)strtoul(seen_pointer + 1, NULL, 10); }
+inline uint16_t code_value_ushort() { return (uint16_t)code_value_ulong(); }
 
-inline uint8_t code_value_byte() { return (uint8_t)(constrain(strtol(seen_pointer + 1, NULL, 10), 0, 255)); }
+inline uint8_t code_value_byte() { return (uint8_t)(constrain(code_value_long(), 0, 255)); }
 
 inline bool code_value_bool() { return !code_has_value() || code_value_byte() > 0; }
 
@@ -1278,8 +1787,43 @@ inline bool code_value_bool() { return !code_has_value() || code_value_byte() >
 FORCE_INLINE millis_t code_value_millis() { return code_value_ulong(); }
 inline millis_t code_value_millis_from_seconds() { return code_value_float() * 1000; }
 
+/**
+ * Note where each letter first appears in the arguments, as strchr() would find it
+ */
+inline void parse_command_args() {
+  codes_seen = 0;
+  for (char *p = current_command_args; *p; p++) {
+    const uint8_t i = *p - 'A';
+    if (i <= 'Z' - 'A' && !(codes_seen & (1UL << i))) {
+      codes_seen |= 1UL << i;
+      code_offset[i] = p - current_command_args;
+    }
+  }
+}
+
 bool code_seen(char code) {
-  seen_pointer = strchr(current_command_args, code);
+  const uint8_t i = code - 'A';
+  #if ENABLED(PARSED_COMMAND_QUEUE)
+    if (command_is_parsed) {
+      if (i > 'Z' - 'A') return false;
+      const parsed_command_t &record = command_queue[cmd_queue_index_r];
+      const uint32_t bit = 1UL << i;
+      if (!(record.codes & bit)) return false;
+      seen_has_value = (record.values & bit) != 0;
+      if (seen_has_value) {
+        uint8_t n = 0;
+        for (uint32_t below = record.values & (bit - 1); below; below &= below - 1) n++;
+        seen_value = record.value[n];
+      }
+      else
+        seen_value = 0;
+      return true;
+    }
+  #endif
+  if (i <= 'Z' - 'A')
+    seen_pointer = (codes_seen & (1UL << i)) ? current_command_args + code_offset[i] : NULL;
+  else
+    seen_pointer = strchr(current_command_args, code);
   return (seen_pointer != NULL); // Return TRUE if the code-letter was found
 }
 
@@ -1557,6 +2101,71 @@ inline void line_to_destination() { line_to_destination(feedrate_mm_s); }
 inline void set_current_to_destination() { memcpy(current_position, destination, sizeof(current_position)); }
 inline void set_destination_to_current() { memcpy(destination, current_position, sizeof(destination)); }
 
+#if ENABLED(SEGMENT_COALESCING)
+
+  /**
+   * Segment coalescing
+   *
+   * A G0/G1 move is held back instead of being buffered, and the following
+   * G0/G1 moves extend it while they keep its direction, feedrate and
+   * extrusion per mm. The held move goes to the planner when a move doesn't
+   * fit, before any other command runs, or when the planner runs low.
+   * The planner also flushes it before taking a move or position from
+   * anywhere else, such as homing, probing or the LCD.
+   */
+  static bool coalesce_next_move = false,   // Set by G0/G1 so only its own move is held
+              coalesce_pending = false;     // A move is being held
+  static float coalesce_start[XYZE],        // Start of the held move, which is the planner position
+               coalesce_end[XYZE],          // End of the held move
+               coalesce_fr_mm_s;            // Feedrate of the held move
+  static uint8_t coalesce_count;            // Segments in the held move
+  static uint32_t coalesce_segments = 0,    // Segments held since the last M802 R
+                  coalesce_merged = 0;      // Segments merged into the move before them
+
+  void flush_coalesced_move() {
+    if (!coalesce_pending) return;
+    coalesce_pending = false;
+    planner.buffer_line(coalesce_end[X_AXIS], coalesce_end[Y_AXIS], coalesce_end[Z_AXIS], coalesce_end[E_AXIS], coalesce_fr_mm_s, active_extruder);
+  }
+
+  /**
+   * Merge the move from current_position to destination into the held
+   * move, or buffer the held move and hold this one instead.
+   */
+  void coalesce_move(const float fr_mm_s) {
+    coalesce_segments++;
+
+    if (coalesce_pending && fr_mm_s == coalesce_fr_mm_s && coalesce_count < COALESCE_MAX_SEGMENTS) {
+      float held[XYZE], delta[XYZE];
+      LOOP_XYZE(i) {
+        held[i] = coalesce_end[i] - coalesce_start[i];
+        delta[i] = destination[i] - current_position[i];
+      }
+      const float held_mm = sqrt(sq(held[X_AXIS]) + sq(held[Y_AXIS]) + sq(held[Z_AXIS])),
+                  delta_mm = sqrt(sq(delta[X_AXIS]) + sq(delta[Y_AXIS]) + sq(delta[Z_AXIS])),
+                  dot = held[X_AXIS] * delta[X_AXIS] + held[Y_AXIS] * delta[Y_AXIS] + held[Z_AXIS] * delta[Z_AXIS];
+
+      // Same direction within COALESCE_MAX_ANGLE, and the same E per mm within COALESCE_MAX_E_CHANGE
+      if (dot >= cos(RADIANS(COALESCE_MAX_ANGLE)) * held_mm * delta_mm
+          && fabs(delta[E_AXIS] * held_mm - held[E_AXIS] * delta_mm) <= (COALESCE_MAX_E_CHANGE) * fabs(held[E_AXIS]) * delta_mm
+      ) {
+        memcpy(coalesce_end, destination, sizeof(coalesce_end));
+        coalesce_count++;
+        coalesce_merged++;
+        return;
+      }
+    }
+
+    flush_coalesced_move();
+    memcpy(coalesce_start, current_position, sizeof(coalesce_start));
+    memcpy(coalesce_end, destination, sizeof(coalesce_end));
+    coalesce_fr_mm_s = fr_mm_s;
+    coalesce_count = 1;
+    coalesce_pending = true;
+  }
+
+#endif // SEGMENT_COALESCING
+
 #if IS_KINEMATIC
   /**
    * Calculate delta, start a line, and set current_position to destination
@@ -2956,6 +3565,10 @@ inline void gcode_G0_G1(
 
     #if IS_SCARA
       fast_move ? prepare_uninterpolated_move_to_destination() : prepare_move_to_destination();
+    #elif ENABLED(SEGMENT_COALESCING)
+      coalesce_next_move = true;
+      prepare_move_to_destination();
+      coalesce_next_move = false;
     #else
       prepare_move_to_destination();
     #endif
@@ -4708,7 +5321,12 @@ inline void gcode_M17() {
   /**
    * M28: Start SD Write
    */
-  inline void gcode_M28() { card.openFile(current_command_args, false); }
+  inline void gcode_M28() {
+    #if ENABLED(PARSED_COMMAND_QUEUE)
+      command_save_queued = false;
+    #endif
+    card.openFile(current_command_args, false);
+  }
 
   /**
    * M29: Stop SD Write
@@ -4816,6 +5434,9 @@ inline void gcode_M31() {
    * M928: Start SD Write
    */
   inline void gcode_M928() {
+    #if ENABLED(PARSED_COMMAND_QUEUE)
+      command_save_queued = false;
+    #endif
     card.openLogFile(current_command_args);
   }
 
@@ -5328,6 +5949,9 @@ inline void gcode_M105() {
   #if HAS_TEMP_HOTEND || HAS_TEMP_BED
     SERIAL_PROTOCOLPGM(MSG_OK);
     print_heaterstates();
+    #if ENABLED(SERIAL_BYTE_CREDITS)
+      report_serial_credits();
+    #endif
   #else // !HAS_TEMP_HOTEND && !HAS_TEMP_BED
     SERIAL_ERROR_START;
     SERIAL_ERRORLNPGM(MSG_ERR_NO_THERMISTORS);
@@ -5336,14 +5960,50 @@ inline void gcode_M105() {
   SERIAL_EOL;
 }
 
-#if ENABLED(AUTO_REPORT_TEMPERATURES) && (HAS_TEMP_HOTEND || HAS_TEMP_BED)
+#if ENABLED(REALTIME_COMMANDS)
 
-  static uint8_t auto_report_temp_interval;
-  static millis_t next_temp_report_ms;
+  volatile bool realtime_status_requested = false;
 
   /**
-   * M155: Set temperature auto-report interval. M155 S<seconds>
-   */
+   * Report the machine state for REALTIME_STATUS. Called from idle(),
+   * so the report doesn't wait behind the command queue, but only
+   * between lines so it never splits a command's own output.
+   *
+   *   <state X:<pos> Y:<pos> Z:<pos> E:<pos> P:<planned moves> Q:<queued commands> T:...>
+   *
+   * The state is Hold, Run or Idle, and the positions are where the steppers are now.
+   */
+  void report_realtime_status() {
+    realtime_status_requested = false;
+    SERIAL_CHAR('<');
+    if (stepper.feed_hold) SERIAL_PROTOCOLPGM("Hold");
+    else if (planner.blocks_queued()) SERIAL_PROTOCOLPGM("Run");
+    else SERIAL_PROTOCOLPGM("Idle");
+    LOOP_XYZE(i) {
+      SERIAL_CHAR(' ');
+      SERIAL_CHAR(axis_codes[i]);
+      SERIAL_CHAR(':');
+      SERIAL_PROTOCOL_F(stepper.get_axis_position_mm((AxisEnum)i), 3);
+    }
+    SERIAL_PROTOCOLPAIR(" P:", (int)planner.movesplanned());
+    SERIAL_PROTOCOLPAIR(" Q:", (int)commands_in_queue);
+    #if HAS_TEMP_HOTEND || HAS_TEMP_BED
+      print_heaterstates();
+    #endif
+    SERIAL_CHAR('>');
+    SERIAL_EOL;
+  }
+
+#endif
+
+#if ENABLED(AUTO_REPORT_TEMPERATURES) && (HAS_TEMP_HOTEND || HAS_TEMP_BED)
+
+  static uint8_t auto_report_temp_interval;
+  static millis_t next_temp_report_ms;
+
+  /**
+   * M155: Set temperature auto-report interval. M155 S<seconds>
+   */
   inline void gcode_M155() {
     if (code_seen('S')) {
       auto_report_temp_interval = code_value_byte();
@@ -6045,6 +6705,11 @@ inline void gcode_M115() {
     #endif
 
   #endif // EXTENDED_CAPABILITIES_REPORT
+
+  // Serial receive buffer, for hosts that stream with byte credits
+  #if ENABLED(SERIAL_BYTE_CREDITS)
+    SERIAL_PROTOCOLLNPAIR("Cap:RX_BUFFER_SIZE:", RX_BUFFER_SIZE - 1);
+  #endif
 }
 
 /**
@@ -6278,6 +6943,7 @@ inline void gcode_M204() {
  *    Y = Max Y Jerk (units/sec^2)
  *    Z = Max Z Jerk (units/sec^2)
  *    E = Max E Jerk (units/sec^2)
+ *    J = Junction Deviation (units) (Requires JUNCTION_DEVIATION)
  */
 inline void gcode_M205() {
   if (code_seen('S')) planner.min_feedrate_mm_s = code_value_linear_units();
@@ -6287,6 +6953,17 @@ inline void gcode_M205() {
   if (code_seen('Y')) planner.max_jerk[Y_AXIS] = code_value_axis_units(Y_AXIS);
   if (code_seen('Z')) planner.max_jerk[Z_AXIS] = code_value_axis_units(Z_AXIS);
   if (code_seen('E')) planner.max_jerk[E_AXIS] = code_value_axis_units(E_AXIS);
+  #if ENABLED(JUNCTION_DEVIATION)
+    if (code_seen('J')) {
+      const float junc_dev = code_value_linear_units();
+      if (junc_dev > 0.0)
+        planner.junction_deviation_mm = junc_dev;
+      else {
+        SERIAL_ERROR_START;
+        SERIAL_ERRORLNPGM("?J out of range (must be > 0)");
+      }
+    }
+  #endif
 }
 
 /**
@@ -6990,6 +7667,9 @@ inline void gcode_M400() { stepper.synchronize(); }
 #endif // FILAMENT_WIDTH_SENSOR
 
 void quickstop_stepper() {
+  #if ENABLED(SEGMENT_COALESCING)
+    coalesce_pending = false; // Drop the held move too
+  #endif
   stepper.quick_stop();
   stepper.synchronize();
   set_current_from_steppers_for_axis(ALL_AXES);
@@ -7390,6 +8070,91 @@ inline void gcode_M503() {
 
 #endif // M605
 
+#if ENABLED(PLANNER_PROFILING)
+  /**
+   * M801: Report planner timing
+   *
+   *   R    Reset the counters
+   *   D<0|1> Disable or enable echoing each finished trapezoid
+   */
+  inline void gcode_M801() {
+    if (code_seen('D')) planner.profile_dump_trapezoids = code_value_bool();
+    if (code_seen('R'))
+      planner.profile_reset();
+    else
+      planner.profile_report();
+  }
+#endif
+
+#if ENABLED(SEGMENT_COALESCING)
+  /**
+   * M802: Report segment coalescing
+   *
+   *   R    Reset the counters
+   */
+  inline void gcode_M802() {
+    if (code_seen('R')) {
+      coalesce_segments = coalesce_merged = 0;
+      return;
+    }
+    SERIAL_ECHO_START;
+    SERIAL_ECHOPAIR("Segments:", (unsigned long)coalesce_segments);
+    SERIAL_ECHOLNPAIR(" merged:", (unsigned long)coalesce_merged);
+  }
+#endif
+
+#if ENABLED(ISR_PROFILING)
+  /**
+   * M803: Report stepper and temperature interrupt timing
+   *
+   *   R    Reset the counters
+   *
+   * With STEP_SEGMENT_BUFFER the temperature interrupt's timing includes
+   * the segments it prepares while the main loop is held up.
+   */
+  inline void gcode_M803() {
+    if (code_seen('R')) {
+      stepper.profile_reset();
+      thermalManager.profile_reset();
+      return;
+    }
+    stepper.profile_report();
+    thermalManager.profile_report();
+  }
+#endif
+
+#if ENABLED(BINARY_MOVE_PROTOCOL)
+  /**
+   * M805: Accept binary move frames between G-code lines
+   *
+   *   S<bool>  Turn binary frames on (default) or off
+   *
+   * Frame numbers start over at 0.
+   */
+  inline void gcode_M805() {
+    binary_moves_enabled = code_seen('S') ? code_value_bool() : true;
+    binary_sequence = 0;
+    binary_resend_pending = false;
+  }
+#endif
+
+#if ENABLED(SD_TRANSFER_PROFILING)
+  /**
+   * M806: Report SD block transfer timing and cache hits
+   *
+   *   R    Reset the counters
+   */
+  inline void gcode_M806() {
+    if (code_seen('R')) {
+      Sd2Card::profile_reset();
+      SdVolume::profile_reset();
+      return;
+    }
+    Sd2Card::profile_report();
+    SdVolume::profile_report();
+  }
+#endif
+
 #if ENABLED(LIN_ADVANCE)
   /**
    * M905: Set advance factor
@@ -7950,11 +8715,446 @@ inline void gcode_T(uint8_t tmp_extruder) {
 }
 
 /**
- * Process a single command and dispatch it to its handler
- * This is called from the main loop()
+ * Commands that need more than a plain call to their handler
  */
-void process_next_command() {
-  current_command = command_queue[cmd_queue_index_r];
+#if IS_SCARA
+  inline void gcode_G0() { gcode_G0_G1(true); }
+  inline void gcode_G1() { gcode_G0_G1(false); }
+#endif
+
+#if ENABLED(ARC_SUPPORT) && DISABLED(SCARA)
+  inline void gcode_G2() { gcode_G2_G3(true); }
+  inline void gcode_G3() { gcode_G2_G3(false); }
+#endif
+
+#if ENABLED(FWRETRACT)
+  inline void gcode_G10() { gcode_G10_G11(true); }
+  inline void gcode_G11() { gcode_G10_G11(false); }
+#endif
+
+#if ENABLED(G38_PROBE_TARGET)
+  inline void gcode_G38_2_3() {
+    if (current_command_subcode == 2 || current_command_subcode == 3)
+      gcode_G38(current_command_subcode == 2);
+  }
+#endif
+
+inline void gcode_G90() { relative_mode = false; }
+inline void gcode_G91() { relative_mode = true; }
+
+// M105 sends its own "ok" with the temperatures
+inline void gcode_M105_no_ok() {
+  gcode_M105();
+  COMMAND_SKIP_OK();
+}
+
+#if ENABLED(MORGAN_SCARA)
+  // No "ok" is sent after a SCARA calibration move
+  #define SCARA_CAL_NO_OK(N) inline void gcode_M##N##_no_ok() { if (gcode_M##N()) COMMAND_SKIP_OK(); }
+  SCARA_CAL_NO_OK(360)
+  SCARA_CAL_NO_OK(361)
+  SCARA_CAL_NO_OK(362)
+  SCARA_CAL_NO_OK(363)
+  SCARA_CAL_NO_OK(364)
+#endif
+
+/**
+ * The G and M commands built into this firmware, sorted by code so
+ * process_next_command() can find a handler with a binary search.
+ */
+typedef void (*gcode_handler_t)();
+
+typedef struct {
+  uint16_t code;            // G_CODE(n) or M_CODE(n)
+  gcode_handler_t handler;
+} gcode_command_t;
+
+#define G_CODE(N) (N)
+#define M_CODE(N) (1000 + (N))
+
+#if ENABLED(COMMAND_PROFILING)
+  inline void gcode_M804();
+#endif
+
+static constexpr gcode_command_t gcode_commands[] PROGMEM = {
+  #if IS_SCARA
+    { G_CODE(0), gcode_G0 },
+    { G_CODE(1), gcode_G1 },
+  #else
+    { G_CODE(0), gcode_G0_G1 },
+    { G_CODE(1), gcode_G0_G1 },
+  #endif
+  #if ENABLED(ARC_SUPPORT) && DISABLED(SCARA)
+    { G_CODE(2), gcode_G2 },
+    { G_CODE(3), gcode_G3 },
+  #endif
+  { G_CODE(4), gcode_G4 },
+  #if ENABLED(BEZIER_CURVE_SUPPORT)
+    { G_CODE(5), gcode_G5 },
+  #endif
+  #if ENABLED(FWRETRACT)
+    { G_CODE(10), gcode_G10 },
+    { G_CODE(11), gcode_G11 },
+  #endif
+  #if ENABLED(NOZZLE_CLEAN_FEATURE)
+    { G_CODE(12), gcode_G12 },
+  #endif
+  #if ENABLED(INCH_MODE_SUPPORT)
+    { G_CODE(20), gcode_G20 },
+    { G_CODE(21), gcode_G21 },
+  #endif
+  #if ENABLED(NOZZLE_PARK_FEATURE)
+    { G_CODE(27), gcode_G27 },
+  #endif
+  { G_CODE(28), gcode_G28 },
+  #if PLANNER_LEVELING
+    { G_CODE(29), gcode_G29 },
+  #endif
+  #if HAS_BED_PROBE
+    { G_CODE(30), gcode_G30 },
+    #if ENABLED(Z_PROBE_SLED)
+      { G_CODE(31), gcode_G31 },
+      { G_CODE(32), gcode_G32 },
+    #endif
+  #endif
+  #if ENABLED(G38_PROBE_TARGET)
+    { G_CODE(38), gcode_G38_2_3 },
+  #endif
+  { G_CODE(90), gcode_G90 },
+  { G_CODE(91), gcode_G91 },
+  { G_CODE(92), gcode_G92 },
+  #if ENABLED(ULTIPANEL) || ENABLED(EMERGENCY_PARSER)
+    { M_CODE(0), gcode_M0_M1 },
+    { M_CODE(1), gcode_M0_M1 },
+  #endif
+  { M_CODE(17), gcode_M17 },
+  { M_CODE(18), gcode_M18_M84 },
+  #if ENABLED(SDSUPPORT)
+    { M_CODE(20), gcode_M20 },
+    { M_CODE(21), gcode_M21 },
+    { M_CODE(22), gcode_M22 },
+    { M_CODE(23), gcode_M23 },
+    { M_CODE(24), gcode_M24 },
+    { M_CODE(25), gcode_M25 },
+    { M_CODE(26), gcode_M26 },
+    { M_CODE(27), gcode_M27 },
+    { M_CODE(28), gcode_M28 },
+    { M_CODE(29), gcode_M29 },
+    { M_CODE(30), gcode_M30 },
+  #endif
+  { M_CODE(31), gcode_M31 },
+  #if ENABLED(SDSUPPORT)
+    { M_CODE(32), gcode_M32 },
+    #if ENABLED(LONG_FILENAME_HOST_SUPPORT)
+      { M_CODE(33), gcode_M33 },
+    #endif
+    #if ENABLED(SDCARD_SORT_ALPHA) && SORT_ONOFF
+      { M_CODE(34), gcode_M34 },
+    #endif
+  #endif
+  { M_CODE(42), gcode_M42 },
+  #if ENABLED(PINS_DEBUGGING)
+    { M_CODE(43), gcode_M43 },
+  #endif
+  #if ENABLED(Z_MIN_PROBE_REPEATABILITY_TEST)
+    { M_CODE(48), gcode_M48 },
+  #endif
+  { M_CODE(75), gcode_M75 },
+  { M_CODE(76), gcode_M76 },
+  { M_CODE(77), gcode_M77 },
+  #if ENABLED(PRINTCOUNTER)
+    { M_CODE(78), gcode_M78 },
+  #endif
+  #if HAS_POWER_SWITCH
+    { M_CODE(80), gcode_M80 },
+  #endif
+  { M_CODE(81), gcode_M81 },
+  { M_CODE(82), gcode_M82 },
+  { M_CODE(83), gcode_M83 },
+  { M_CODE(84), gcode_M18_M84 },
+  { M_CODE(85), gcode_M85 },
+  { M_CODE(92), gcode_M92 },
+  #if ENABLED(M100_FREE_MEMORY_WATCHER)
+    { M_CODE(100), gcode_M100 },
+  #endif
+  { M_CODE(104), gcode_M104 },
+  { M_CODE(105), gcode_M105_no_ok },
+  #if FAN_COUNT > 0
+    { M_CODE(106), gcode_M106 },
+    { M_CODE(107), gcode_M107 },
+  #endif
+  #if DISABLED(EMERGENCY_PARSER)
+    { M_CODE(108), gcode_M108 },
+  #endif
+  { M_CODE(109), gcode_M109 },
+  { M_CODE(110), gcode_M110 },
+  { M_CODE(111), gcode_M111 },
+  #if DISABLED(EMERGENCY_PARSER)
+    { M_CODE(112), gcode_M112 },
+  #endif
+  #if ENABLED(HOST_KEEPALIVE_FEATURE)
+    { M_CODE(113), gcode_M113 },
+  #endif
+  { M_CODE(114), gcode_M114 },
+  { M_CODE(115), gcode_M115 },
+  { M_CODE(117), gcode_M117 },
+  { M_CODE(119), gcode_M119 },
+  { M_CODE(120), gcode_M120 },
+  { M_CODE(121), gcode_M121 },
+  #if ENABLED(HAVE_TMC2130DRIVER)
+    { M_CODE(122), gcode_M122 },
+  #endif
+  #if ENABLED(BARICUDA)
+    #if HAS_HEATER_1
+      { M_CODE(126), gcode_M126 },
+      { M_CODE(127), gcode_M127 },
+    #endif
+    #if HAS_HEATER_2
+      { M_CODE(128), gcode_M128 },
+      { M_CODE(129), gcode_M129 },
+    #endif
+  #endif
+  { M_CODE(140), gcode_M140 },
+  #if ENABLED(ULTIPANEL)
+    { M_CODE(145), gcode_M145 },
+  #endif
+  #if ENABLED(TEMPERATURE_UNITS_SUPPORT)
+    { M_CODE(149), gcode_M149 },
+  #endif
+  #if ENABLED(BLINKM) || ENABLED(RGB_LED)
+    { M_CODE(150), gcode_M150 },
+  #endif
+  #if ENABLED(AUTO_REPORT_TEMPERATURES) && (HAS_TEMP_HOTEND || HAS_TEMP_BED)
+    { M_CODE(155), gcode_M155 },
+  #endif
+  #if ENABLED(MIXING_EXTRUDER)
+    { M_CODE(163), gcode_M163 },
+    #if MIXING_VIRTUAL_TOOLS > 1
+      { M_CODE(164), gcode_M164 },
+    #endif
+    #if ENABLED(DIRECT_MIXING_IN_G1)
+      { M_CODE(165), gcode_M165 },
+    #endif
+  #endif
+  #if HAS_TEMP_BED
+    { M_CODE(190), gcode_M190 },
+  #endif
+  { M_CODE(200), gcode_M200 },
+  { M_CODE(201), gcode_M201 },
+  { M_CODE(203), gcode_M203 },
+  { M_CODE(204), gcode_M204 },
+  { M_CODE(205), gcode_M205 },
+  { M_CODE(206), gcode_M206 },
+  #if ENABLED(FWRETRACT)
+    { M_CODE(207), gcode_M207 },
+    { M_CODE(208), gcode_M208 },
+    { M_CODE(209), gcode_M209 },
+  #endif
+  { M_CODE(211), gcode_M211 },
+  #if HOTENDS > 1
+    { M_CODE(218), gcode_M218 },
+  #endif
+  { M_CODE(220), gcode_M220 },
+  { M_CODE(221), gcode_M221 },
+  { M_CODE(226), gcode_M226 },
+  #if defined(CHDK) || HAS_PHOTOGRAPH
+    { M_CODE(240), gcode_M240 },
+  #endif
+  #if HAS_LCD_CONTRAST
+    { M_CODE(250), gcode_M250 },
+  #endif
+  #if ENABLED(EXPERIMENTAL_I2CBUS)
+    { M_CODE(260), gcode_M260 },
+    { M_CODE(261), gcode_M261 },
+  #endif
+  #if HAS_SERVOS
+    { M_CODE(280), gcode_M280 },
+  #endif
+  #if HAS_BUZZER
+    { M_CODE(300), gcode_M300 },
+  #endif
+  #if ENABLED(PIDTEMP)
+    { M_CODE(301), gcode_M301 },
+  #endif
+  #if ENABLED(PREVENT_COLD_EXTRUSION)
+    { M_CODE(302), gcode_M302 },
+  #endif
+  { M_CODE(303), gcode_M303 },
+  #if ENABLED(PIDTEMPBED)
+    { M_CODE(304), gcode_M304 },
+  #endif
+  #if HAS_MICROSTEPS
+    { M_CODE(350), gcode_M350 },
+    { M_CODE(351), gcode_M351 },
+  #endif
+  #if HAS_CASE_LIGHT
+    { M_CODE(355), gcode_M355 },
+  #endif
+  #if ENABLED(MORGAN_SCARA)
+    { M_CODE(360), gcode_M360_no_ok },
+    { M_CODE(361), gcode_M361_no_ok },
+    { M_CODE(362), gcode_M362_no_ok },
+    { M_CODE(363), gcode_M363_no_ok },
+    { M_CODE(364), gcode_M364_no_ok },
+  #endif
+  { M_CODE(400), gcode_M400 },
+  #if HAS_BED_PROBE
+    { M_CODE(401), gcode_M401 },
+    { M_CODE(402), gcode_M402 },
+  #endif
+  #if ENABLED(FILAMENT_WIDTH_SENSOR)
+    { M_CODE(404), gcode_M404 },
+    { M_CODE(405), gcode_M405 },
+    { M_CODE(406), gcode_M406 },
+    { M_CODE(407), gcode_M407 },
+  #endif
+  #if DISABLED(EMERGENCY_PARSER)
+    { M_CODE(410), gcode_M410 },
+  #endif
+  #if PLANNER_LEVELING
+    { M_CODE(420), gcode_M420 },
+  #endif
+  #if ENABLED(MESH_BED_LEVELING)
+    { M_CODE(421), gcode_M421 },
+  #endif
+  { M_CODE(428), gcode_M428 },
+  { M_CODE(500), gcode_M500 },
+  { M_CODE(501), gcode_M501 },
+  { M_CODE(502), gcode_M502 },
+  { M_CODE(503), gcode_M503 },
+  #if ENABLED(ABORT_ON_ENDSTOP_HIT_FEATURE_ENABLED)
+    { M_CODE(540), gcode_M540 },
+  #endif
+  #if ENABLED(FILAMENT_CHANGE_FEATURE)
+    { M_CODE(600), gcode_M600 },
+  #endif
+  #if ENABLED(DUAL_X_CARRIAGE)
+    { M_CODE(605), gcode_M605 },
+  #endif
+  #if ENABLED(DELTA)
+    { M_CODE(665), gcode_M665 },
+  #endif
+  #if ENABLED(DELTA) || ENABLED(Z_DUAL_ENDSTOPS)
+    { M_CODE(666), gcode_M666 },
+  #endif
+  #if ENABLED(PLANNER_PROFILING)
+    { M_CODE(801), gcode_M801 },
+  #endif
+  #if ENABLED(SEGMENT_COALESCING)
+    { M_CODE(802), gcode_M802 },
+  #endif
+  #if ENABLED(ISR_PROFILING)
+    { M_CODE(803), gcode_M803 },
+  #endif
+  #if ENABLED(COMMAND_PROFILING)
+    { M_CODE(804), gcode_M804 },
+  #endif
+  #if ENABLED(BINARY_MOVE_PROTOCOL)
+    { M_CODE(805), gcode_M805 },
+  #endif
+  #if ENABLED(SD_TRANSFER_PROFILING)
+    { M_CODE(806), gcode_M806 },
+  #endif
+  #if HAS_BED_PROBE
+    { M_CODE(851), gcode_M851 },
+  #endif
+  #if ENABLED(LIN_ADVANCE)
+    { M_CODE(905), gcode_M905 },
+  #endif
+  { M_CODE(907), gcode_M907 },
+  #if HAS_DIGIPOTSS || ENABLED(DAC_STEPPER_CURRENT)
+    { M_CODE(908), gcode_M908 },
+  #endif
+  #if ENABLED(DAC_STEPPER_CURRENT)
+    { M_CODE(909), gcode_M909 },
+    { M_CODE(910), gcode_M910 },
+  #endif
+  #if ENABLED(SDSUPPORT)
+    { M_CODE(928), gcode_M928 },
+  #endif
+  { M_CODE(999), gcode_M999 },
+};
+
+constexpr bool gcode_commands_sorted(const uint8_t i=1) {
+  return i >= COUNT(gcode_commands) || (gcode_commands[i - 1].code < gcode_commands[i].code && gcode_commands_sorted(i + 1));
+}
+static_assert(gcode_commands_sorted(), "gcode_commands must be sorted by code.");
+static_assert(COUNT(gcode_commands) < 256, "gcode_commands has too many entries.");
+
+#if ENABLED(COMMAND_PROFILING)
+  static uint32_t gcode_command_count[COUNT(gcode_commands)], // Times each command was run
+                  t_command_count;                            // Tool changes
+#endif
+
+/**
+ * Run the handler for a G or M code. Return false if there is none.
+ */
+static bool run_gcode_command(const uint16_t code) {
+  uint8_t lo = 0, hi = COUNT(gcode_commands);
+  while (lo < hi) {
+    const uint8_t mid = (lo + hi) >> 1;
+    const uint16_t c = pgm_read_word(&gcode_commands[mid].code);
+    if (c < code)
+      lo = mid + 1;
+    else if (c > code)
+      hi = mid;
+    else {
+      #if ENABLED(COMMAND_PROFILING)
+        gcode_command_count[mid]++;
+      #endif
+      ((gcode_handler_t)pgm_read_word(&gcode_commands[mid].handler))();
+      return true;
+    }
+  }
+  return false;
+}
+
+#if ENABLED(COMMAND_PROFILING)
+  /**
+   * M804: Report how many times each command was run
+   *
+   *   R    Reset the counters
+   */
+  inline void gcode_M804() {
+    const bool reset = code_seen('R');
+    for (uint8_t i = 0; i < COUNT(gcode_commands); i++) {
+      if (reset)
+        gcode_command_count[i] = 0;
+      else if (gcode_command_count[i]) {
+        const uint16_t code = pgm_read_word(&gcode_commands[i].code);
+        SERIAL_ECHO_START;
+        if (code < M_CODE(0)) {
+          SERIAL_CHAR('G');
+          SERIAL_ECHO(code);
+        }
+        else {
+          SERIAL_CHAR('M');
+          SERIAL_ECHO(code - M_CODE(0));
+        }
+        SERIAL_ECHOLNPAIR(":", (unsigned long)gcode_command_count[i]);
+      }
+    }
+    if (reset)
+      t_command_count = 0;
+    else if (t_command_count) {
+      SERIAL_ECHO_START;
+      SERIAL_ECHOLNPAIR("T:", (unsigned long)t_command_count);
+    }
+  }
+#endif
+
+/**
+ * Get the code, number and arguments of the current command from its text.
+ * Return false if there's no code number.
+ */
+inline bool parse_command_text(char &command_code, uint16_t &codenum) {
+  #if ENABLED(PARSED_COMMAND_QUEUE)
+    current_command = command_text[command_text_index_r];
+  #elif ENABLED(PACKED_COMMAND_QUEUE)
+    current_command = &command_queue[cmd_queue_index_r + 1];
+  #else
+    current_command = command_queue[cmd_queue_index_r];
+  #endif
 
   if (DEBUGGING(ECHO)) {
     SERIAL_ECHO_START;
@@ -7977,21 +9177,15 @@ void process_next_command() {
   char *cmd_ptr = current_command;
 
   // Get the command code, which must be G, M, or T
-  char command_code = *cmd_ptr++;
+  command_code = *cmd_ptr++;
 
   // Skip spaces to get the numeric part
   while (*cmd_ptr == ' ') cmd_ptr++;
 
-  // Allow for decimal point in command
-  #if ENABLED(G38_PROBE_TARGET)
-    uint8_t subcode = 0;
-  #endif
-
-  uint16_t codenum = 0; // define ahead of goto
-
   // Bail early if there's no code
-  bool code_is_good = NUMERIC(*cmd_ptr);
-  if (!code_is_good) goto ExitUnknownCommand;
+  if (!NUMERIC(*cmd_ptr)) return false;
+
+  codenum = 0;
 
   // Get and skip the code number
   do {
@@ -8001,10 +9195,11 @@ void process_next_command() {
 
   // Allow for decimal point in command
   #if ENABLED(G38_PROBE_TARGET)
+    current_command_subcode = 0;
     if (*cmd_ptr == '.') {
       cmd_ptr++;
       while (NUMERIC(*cmd_ptr))
-        subcode = (subcode * 10) + (*cmd_ptr++ - '0');
+        current_command_subcode = (current_command_subcode * 10) + (*cmd_ptr++ - '0');
     }
   #endif
 
@@ -8013,673 +9208,79 @@ void process_next_command() {
 
   // The command's arguments (if any) start here, for sure!
   current_command_args = cmd_ptr;
+  parse_command_args();
 
-  KEEPALIVE_STATE(IN_HANDLER);
+  return true;
+}
 
-  // Handle a known G, M, or T
-  switch (command_code) {
-    case 'G': switch (codenum) {
+/**
+ * Process a single command and dispatch it to its handler
+ * This is called from the main loop()
+ */
+void process_next_command() {
+  char command_code;
+  uint16_t codenum;
+  bool code_is_good = true;
+
+  #if ENABLED(PARSED_COMMAND_QUEUE)
+    const parsed_command_t &record = command_queue[cmd_queue_index_r];
+    command_is_parsed = record.command_code != 0;
+    if (command_is_parsed) {
+      command_code = record.command_code;
+      codenum = record.codenum;
+      #if ENABLED(G38_PROBE_TARGET)
+        current_command_subcode = record.subcode;
+      #endif
+      static char no_text[] = "";
+      current_command = current_command_args = no_text;
 
-      // G0, G1
-      case 0:
-      case 1:
-        #if IS_SCARA
-          gcode_G0_G1(codenum == 0);
-        #else
-          gcode_G0_G1();
+      if (DEBUGGING(ECHO)) {
+        SERIAL_ECHO_START;
+        SERIAL_ECHO(command_code);
+        SERIAL_ECHO(codenum);
+        #if ENABLED(G38_PROBE_TARGET)
+          if (record.subcode) { SERIAL_CHAR('.'); SERIAL_ECHO((int)record.subcode); }
         #endif
-        break;
+        uint8_t n = 0;
+        for (uint8_t i = 0; i <= 'Z' - 'A'; i++) {
+          const uint32_t bit = 1UL << i;
+          if (!(record.codes & bit)) continue;
+          SERIAL_CHAR(' ');
+          SERIAL_CHAR('A' + i);
+          if (record.values & bit) SERIAL_PROTOCOL_F(record.value[n++], 5);
+        }
+        SERIAL_EOL;
+      }
+    }
+    else
+  #endif
+  if (!parse_command_text(command_code, codenum)) {
+    unknown_command_error();
+    ok_to_send();
+    return;
+  }
 
-      // G2, G3
-      #if ENABLED(ARC_SUPPORT) && DISABLED(SCARA)
-        case 2: // G2  - CW ARC
-        case 3: // G3  - CCW ARC
-          gcode_G2_G3(codenum == 2);
-          break;
-      #endif
-
-      // G4 Dwell
-      case 4:
-        gcode_G4();
-        break;
-
-      #if ENABLED(BEZIER_CURVE_SUPPORT)
-        // G5
-        case 5: // G5  - Cubic B_spline
-          gcode_G5();
-          break;
-      #endif // BEZIER_CURVE_SUPPORT
-
-      #if ENABLED(FWRETRACT)
-        case 10: // G10: retract
-        case 11: // G11: retract_recover
-          gcode_G10_G11(codenum == 10);
-          break;
-      #endif // FWRETRACT
-
-      #if ENABLED(NOZZLE_CLEAN_FEATURE)
-        case 12:
-          gcode_G12(); // G12: Nozzle Clean
-          break;
-      #endif // NOZZLE_CLEAN_FEATURE
-
-      #if ENABLED(INCH_MODE_SUPPORT)
-        case 20: //G20: Inch Mode
-          gcode_G20();
-          break;
-
-        case 21: //G21: MM Mode
-          gcode_G21();
-          break;
-      #endif // INCH_MODE_SUPPORT
-
-      #if ENABLED(NOZZLE_PARK_FEATURE)
-        case 27: // G27: Nozzle Park
-          gcode_G27();
-          break;
-      #endif // NOZZLE_PARK_FEATURE
-
-      case 28: // G28: Home all axes, one at a time
-        gcode_G28();
-        break;
-
-      #if PLANNER_LEVELING
-        case 29: // G29 Detailed Z probe, probes the bed at 3 or more points.
-          gcode_G29();
-          break;
-      #endif // PLANNER_LEVELING
-
-      #if HAS_BED_PROBE
-
-        case 30: // G30 Single Z probe
-          gcode_G30();
-          break;
-
-        #if ENABLED(Z_PROBE_SLED)
-
-            case 31: // G31: dock the sled
-              gcode_G31();
-              break;
-
-            case 32: // G32: undock the sled
-              gcode_G32();
-              break;
-
-        #endif // Z_PROBE_SLED
-      #endif // HAS_BED_PROBE
-
-      #if ENABLED(G38_PROBE_TARGET)
-        case 38: // G38.2 & G38.3
-          if (subcode == 2 || subcode == 3)
-            gcode_G38(subcode == 2);
-          break;
-      #endif
-
-      case 90: // G90
-        relative_mode = false;
-        break;
-      case 91: // G91
-        relative_mode = true;
-        break;
-
-      case 92: // G92
-        gcode_G92();
-        break;
-    }
-    break;
-
-    case 'M': switch (codenum) {
-      #if ENABLED(ULTIPANEL) || ENABLED(EMERGENCY_PARSER)
-        case 0: // M0: Unconditional stop - Wait for user button press on LCD
-        case 1: // M1: Conditional stop - Wait for user button press on LCD
-          gcode_M0_M1();
-          break;
-      #endif // ULTIPANEL
-
-      case 17: // M17: Enable all stepper motors
-        gcode_M17();
-        break;
-
-      #if ENABLED(SDSUPPORT)
-        case 20: // M20: list SD card
-          gcode_M20(); break;
-        case 21: // M21: init SD card
-          gcode_M21(); break;
-        case 22: // M22: release SD card
-          gcode_M22(); break;
-        case 23: // M23: Select file
-          gcode_M23(); break;
-        case 24: // M24: Start SD print
-          gcode_M24(); break;
-        case 25: // M25: Pause SD print
-          gcode_M25(); break;
-        case 26: // M26: Set SD index
-          gcode_M26(); break;
-        case 27: // M27: Get SD status
-          gcode_M27(); break;
-        case 28: // M28: Start SD write
-          gcode_M28(); break;
-        case 29: // M29: Stop SD write
-          gcode_M29(); break;
-        case 30: // M30 <filename> Delete File
-          gcode_M30(); break;
-        case 32: // M32: Select file and start SD print
-          gcode_M32(); break;
-
-        #if ENABLED(LONG_FILENAME_HOST_SUPPORT)
-          case 33: // M33: Get the long full path to a file or folder
-            gcode_M33(); break;
-        #endif
-
-        #if ENABLED(SDCARD_SORT_ALPHA) && SORT_ONOFF
-          case 34: //M34 - Set SD card sorting options
-            gcode_M34(); break;
-        #endif // SDCARD_SORT_ALPHA && SORT_ONOFF
-
-        case 928: // M928: Start SD write
-          gcode_M928(); break;
-      #endif //SDSUPPORT
-
-      case 31: // M31: Report time since the start of SD print or last M109
-        gcode_M31(); break;
-
-      case 42: // M42: Change pin state
-        gcode_M42(); break;
-
-      #if ENABLED(PINS_DEBUGGING)
-        case 43: // M43: Read pin state
-          gcode_M43(); break;
-      #endif
-
-      #if ENABLED(Z_MIN_PROBE_REPEATABILITY_TEST)
-        case 48: // M48: Z probe repeatability test
-          gcode_M48();
-          break;
-      #endif // Z_MIN_PROBE_REPEATABILITY_TEST
-
-      case 75: // M75: Start print timer
-        gcode_M75(); break;
-      case 76: // M76: Pause print timer
-        gcode_M76(); break;
-      case 77: // M77: Stop print timer
-        gcode_M77(); break;
-
-      #if ENABLED(PRINTCOUNTER)
-        case 78: // M78: Show print statistics
-          gcode_M78(); break;
-      #endif
-
-      #if ENABLED(M100_FREE_MEMORY_WATCHER)
-        case 100: // M100: Free Memory Report
-          gcode_M100();
-          break;
-      #endif
-
-      case 104: // M104: Set hot end temperature
-        gcode_M104();
-        break;
-
-      case 110: // M110: Set Current Line Number
-        gcode_M110();
-        break;
-
-      case 111: // M111: Set debug level
-        gcode_M111();
-        break;
-
-      #if DISABLED(EMERGENCY_PARSER)
-
-        case 108: // M108: Cancel Waiting
-          gcode_M108();
-          break;
-
-        case 112: // M112: Emergency Stop
-          gcode_M112();
-          break;
-
-        case 410: // M410 quickstop - Abort all the planned moves.
-          gcode_M410();
-          break;
-
-      #endif
-
-      #if ENABLED(HOST_KEEPALIVE_FEATURE)
-        case 113: // M113: Set Host Keepalive interval
-          gcode_M113();
-          break;
-      #endif
-
-      case 140: // M140: Set bed temperature
-        gcode_M140();
-        break;
-
-      case 105: // M105: Report current temperature
-        gcode_M105();
-        KEEPALIVE_STATE(NOT_BUSY);
-        return; // "ok" already printed
-
-      #if ENABLED(AUTO_REPORT_TEMPERATURES) && (HAS_TEMP_HOTEND || HAS_TEMP_BED)
-        case 155: // M155: Set temperature auto-report interval
-          gcode_M155();
-          break;
-      #endif
-
-      case 109: // M109: Wait for hotend temperature to reach target
-        gcode_M109();
-        break;
-
-      #if HAS_TEMP_BED
-        case 190: // M190: Wait for bed temperature to reach target
-          gcode_M190();
-          break;
-      #endif // HAS_TEMP_BED
-
-      #if FAN_COUNT > 0
-        case 106: // M106: Fan On
-          gcode_M106();
-          break;
-        case 107: // M107: Fan Off
-          gcode_M107();
-          break;
-      #endif // FAN_COUNT > 0
-
-      #if ENABLED(BARICUDA)
-        // PWM for HEATER_1_PIN
-        #if HAS_HEATER_1
-          case 126: // M126: valve open
-            gcode_M126();
-            break;
-          case 127: // M127: valve closed
-            gcode_M127();
-            break;
-        #endif // HAS_HEATER_1
-
-        // PWM for HEATER_2_PIN
-        #if HAS_HEATER_2
-          case 128: // M128: valve open
-            gcode_M128();
-            break;
-          case 129: // M129: valve closed
-            gcode_M129();
-            break;
-        #endif // HAS_HEATER_2
-      #endif // BARICUDA
-
-      #if HAS_POWER_SWITCH
-
-        case 80: // M80: Turn on Power Supply
-          gcode_M80();
-          break;
-
-      #endif // HAS_POWER_SWITCH
-
-      case 81: // M81: Turn off Power, including Power Supply, if possible
-        gcode_M81();
-        break;
-
-      case 82: // M83: Set E axis normal mode (same as other axes)
-        gcode_M82();
-        break;
-      case 83: // M83: Set E axis relative mode
-        gcode_M83();
-        break;
-      case 18: // M18 => M84
-      case 84: // M84: Disable all steppers or set timeout
-        gcode_M18_M84();
-        break;
-      case 85: // M85: Set inactivity stepper shutdown timeout
-        gcode_M85();
-        break;
-      case 92: // M92: Set the steps-per-unit for one or more axes
-        gcode_M92();
-        break;
-      case 114: // M114: Report current position
-        gcode_M114();
-        break;
-      case 115: // M115: Report capabilities
-        gcode_M115();
-        break;
-      case 117: // M117: Set LCD message text, if possible
-        gcode_M117();
-        break;
-      case 119: // M119: Report endstop states
-        gcode_M119();
-        break;
-      case 120: // M120: Enable endstops
-        gcode_M120();
-        break;
-      case 121: // M121: Disable endstops
-        gcode_M121();
-        break;
-
-      #if ENABLED(HAVE_TMC2130DRIVER)
-        case 122: // M122: Diagnose, used to debug TMC2130
-          gcode_M122();
-          break;
-      #endif
-
-      #if ENABLED(ULTIPANEL)
-
-        case 145: // M145: Set material heatup parameters
-          gcode_M145();
-          break;
-
-      #endif
-
-      #if ENABLED(TEMPERATURE_UNITS_SUPPORT)
-        case 149: // M149: Set temperature units
-          gcode_M149();
-          break;
-      #endif
-
-      #if ENABLED(BLINKM) || ENABLED(RGB_LED)
-
-        case 150: // M150: Set Status LED Color
-          gcode_M150();
-          break;
-
-      #endif // BLINKM
-
-      #if ENABLED(MIXING_EXTRUDER)
-        case 163: // M163: Set a component weight for mixing extruder
-          gcode_M163();
-          break;
-        #if MIXING_VIRTUAL_TOOLS > 1
-          case 164: // M164: Save current mix as a virtual extruder
-            gcode_M164();
-            break;
-        #endif
-        #if ENABLED(DIRECT_MIXING_IN_G1)
-          case 165: // M165: Set multiple mix weights
-            gcode_M165();
-            break;
-        #endif
-      #endif
-
-      case 200: // M200: Set filament diameter, E to cubic units
-        gcode_M200();
-        break;
-      case 201: // M201: Set max acceleration for print moves (units/s^2)
-        gcode_M201();
-        break;
-      #if 0 // Not used for Sprinter/grbl gen6
-        case 202: // M202
-          gcode_M202();
-          break;
-      #endif
-      case 203: // M203: Set max feedrate (units/sec)
-        gcode_M203();
-        break;
-      case 204: // M204: Set acceleration
-        gcode_M204();
-        break;
-      case 205: //M205: Set advanced settings
-        gcode_M205();
-        break;
-      case 206: // M206: Set home offsets
-        gcode_M206();
-        break;
-
-      #if ENABLED(DELTA)
-        case 665: // M665: Set delta configurations
-          gcode_M665();
-          break;
-      #endif
-
-      #if ENABLED(DELTA) || ENABLED(Z_DUAL_ENDSTOPS)
-        case 666: // M666: Set delta or dual endstop adjustment
-          gcode_M666();
-          break;
-      #endif
-
-      #if ENABLED(FWRETRACT)
-        case 207: // M207: Set Retract Length, Feedrate, and Z lift
-          gcode_M207();
-          break;
-        case 208: // M208: Set Recover (unretract) Additional Length and Feedrate
-          gcode_M208();
-          break;
-        case 209: // M209: Turn Automatic Retract Detection on/off
-          gcode_M209();
-          break;
-      #endif // FWRETRACT
-
-      case 211: // M211: Enable, Disable, and/or Report software endstops
-        gcode_M211();
-        break;
-
-      #if HOTENDS > 1
-        case 218: // M218: Set a tool offset
-          gcode_M218();
-          break;
-      #endif
-
-      case 220: // M220: Set Feedrate Percentage: S<percent> ("FR" on your LCD)
-        gcode_M220();
-        break;
-
-      case 221: // M221: Set Flow Percentage
-        gcode_M221();
-        break;
-
-      case 226: // M226: Wait until a pin reaches a state
-        gcode_M226();
-        break;
-
-      #if HAS_SERVOS
-        case 280: // M280: Set servo position absolute
-          gcode_M280();
-          break;
-      #endif // HAS_SERVOS
-
-      #if HAS_BUZZER
-        case 300: // M300: Play beep tone
-          gcode_M300();
-          break;
-      #endif // HAS_BUZZER
-
-      #if ENABLED(PIDTEMP)
-        case 301: // M301: Set hotend PID parameters
-          gcode_M301();
-          break;
-      #endif // PIDTEMP
-
-      #if ENABLED(PIDTEMPBED)
-        case 304: // M304: Set bed PID parameters
-          gcode_M304();
-          break;
-      #endif // PIDTEMPBED
-
-      #if defined(CHDK) || HAS_PHOTOGRAPH
-        case 240: // M240: Trigger a camera by emulating a Canon RC-1 : http://www.doc-diy.net/photo/rc-1_hacked/
-          gcode_M240();
-          break;
-      #endif // CHDK || PHOTOGRAPH_PIN
-
-      #if HAS_LCD_CONTRAST
-        case 250: // M250: Set LCD contrast
-          gcode_M250();
-          break;
-      #endif // HAS_LCD_CONTRAST
-
-      #if ENABLED(EXPERIMENTAL_I2CBUS)
-
-        case 260: // M260: Send data to an i2c slave
-          gcode_M260();
-          break;
-
-        case 261: // M261: Request data from an i2c slave
-          gcode_M261();
-          break;
-
-      #endif // EXPERIMENTAL_I2CBUS
-
-      #if ENABLED(PREVENT_COLD_EXTRUSION)
-        case 302: // M302: Allow cold extrudes (set the minimum extrude temperature)
-          gcode_M302();
-          break;
-      #endif // PREVENT_COLD_EXTRUSION
-
-      case 303: // M303: PID autotune
-        gcode_M303();
-        break;
-
-      #if ENABLED(MORGAN_SCARA)
-        case 360:  // M360: SCARA Theta pos1
-          if (gcode_M360()) return;
-          break;
-        case 361:  // M361: SCARA Theta pos2
-          if (gcode_M361()) return;
-          break;
-        case 362:  // M362: SCARA Psi pos1
-          if (gcode_M362()) return;
-          break;
-        case 363:  // M363: SCARA Psi pos2
-          if (gcode_M363()) return;
-          break;
-        case 364:  // M364: SCARA Psi pos3 (90 deg to Theta)
-          if (gcode_M364()) return;
-          break;
-      #endif // SCARA
-
-      case 400: // M400: Finish all moves
-        gcode_M400();
-        break;
-
-      #if HAS_BED_PROBE
-        case 401: // M401: Deploy probe
-          gcode_M401();
-          break;
-        case 402: // M402: Stow probe
-          gcode_M402();
-          break;
-      #endif // HAS_BED_PROBE
-
-      #if ENABLED(FILAMENT_WIDTH_SENSOR)
-        case 404:  // M404: Enter the nominal filament width (3mm, 1.75mm ) N<3.0> or display nominal filament width
-          gcode_M404();
-          break;
-        case 405:  // M405: Turn on filament sensor for control
-          gcode_M405();
-          break;
-        case 406:  // M406: Turn off filament sensor for control
-          gcode_M406();
-          break;
-        case 407:   // M407: Display measured filament diameter
-          gcode_M407();
-          break;
-      #endif // ENABLED(FILAMENT_WIDTH_SENSOR)
-
-      #if PLANNER_LEVELING
-        case 420: // M420: Enable/Disable Bed Leveling
-          gcode_M420();
-          break;
-      #endif
-
-      #if ENABLED(MESH_BED_LEVELING)
-        case 421: // M421: Set a Mesh Bed Leveling Z coordinate
-          gcode_M421();
-          break;
-      #endif
-
-      case 428: // M428: Apply current_position to home_offset
-        gcode_M428();
-        break;
-
-      case 500: // M500: Store settings in EEPROM
-        gcode_M500();
-        break;
-      case 501: // M501: Read settings from EEPROM
-        gcode_M501();
-        break;
-      case 502: // M502: Revert to default settings
-        gcode_M502();
-        break;
-      case 503: // M503: print settings currently in memory
-        gcode_M503();
-        break;
-
-      #if ENABLED(ABORT_ON_ENDSTOP_HIT_FEATURE_ENABLED)
-        case 540: // M540: Set abort on endstop hit for SD printing
-          gcode_M540();
-          break;
-      #endif
-
-      #if HAS_BED_PROBE
-        case 851: // M851: Set Z Probe Z Offset
-          gcode_M851();
-          break;
-      #endif // HAS_BED_PROBE
-
-      #if ENABLED(FILAMENT_CHANGE_FEATURE)
-        case 600: // M600: Pause for filament change
-          gcode_M600();
-          break;
-      #endif // FILAMENT_CHANGE_FEATURE
-
-      #if ENABLED(DUAL_X_CARRIAGE)
-        case 605: // M605: Set Dual X Carriage movement mode
-          gcode_M605();
-          break;
-      #endif // DUAL_X_CARRIAGE
-
-      #if ENABLED(LIN_ADVANCE)
-        case 905: // M905: Set advance K factor.
-          gcode_M905();
-          break;
-      #endif
-
-      case 907: // M907: Set digital trimpot motor current using axis codes.
-        gcode_M907();
-        break;
-
-      #if HAS_DIGIPOTSS || ENABLED(DAC_STEPPER_CURRENT)
-
-        case 908: // M908: Control digital trimpot directly.
-          gcode_M908();
-          break;
-
-        #if ENABLED(DAC_STEPPER_CURRENT) // As with Printrbot RevF
-
-          case 909: // M909: Print digipot/DAC current value
-            gcode_M909();
-            break;
-
-          case 910: // M910: Commit digipot/DAC value to external EEPROM
-            gcode_M910();
-            break;
-
-        #endif
-
-      #endif // HAS_DIGIPOTSS || DAC_STEPPER_CURRENT
-
-      #if HAS_MICROSTEPS
-
-        case 350: // M350: Set microstepping mode. Warning: Steps per unit remains unchanged. S code sets stepping mode for all drivers.
-          gcode_M350();
-          break;
-
-        case 351: // M351: Toggle MS1 MS2 pins directly, S# determines MS1 or MS2, X# sets the pin high/low.
-          gcode_M351();
-          break;
-
-      #endif // HAS_MICROSTEPS
-
-      #if HAS_CASE_LIGHT
+  #if ENABLED(SEGMENT_COALESCING)
+    // Any command but G0/G1 may depend on the planner position
+    if (command_code != 'G' || codenum > 1) flush_coalesced_move();
+  #endif
 
-        case 355: // M355 Turn case lights on/off
-          gcode_M355();
-          break;
+  KEEPALIVE_STATE(IN_HANDLER);
 
-      #endif // HAS_CASE_LIGHT
+  // Handle a known G, M, or T. Unknown G and M numbers are ignored.
+  switch (command_code) {
+    case 'G':
+      if (codenum < 1000) run_gcode_command(G_CODE(codenum));
+      break;
 
-      case 999: // M999: Restart after being Stopped
-        gcode_M999();
-        break;
-    }
-    break;
+    case 'M':
+      if (codenum < 1000) run_gcode_command(M_CODE(codenum));
+      break;
 
     case 'T':
+      #if ENABLED(COMMAND_PROFILING)
+        t_command_count++;
+      #endif
       gcode_T(codenum);
       break;
 
@@ -8688,8 +9289,6 @@ void process_next_command() {
 
   KEEPALIVE_STATE(NOT_BUSY);
 
-ExitUnknownCommand:
-
   // Still unknown command? Throw an error
   if (!code_is_good) unknown_command_error();
 
@@ -8702,6 +9301,9 @@ ExitUnknownCommand:
  */
 void FlushSerialRequestResend() {
   //char command_queue[cmd_queue_index_r][100]="Resend:";
+  #if ENABLED(SERIAL_BYTE_CREDITS)
+    serial_credits += MYSERIAL.available(); // Discarded characters are credited too
+  #endif
   MYSERIAL.flush();
   SERIAL_PROTOCOLPGM(MSG_RESEND);
   SERIAL_PROTOCOLLN(gcode_LastN + 1);
@@ -8716,13 +9318,20 @@ void FlushSerialRequestResend() {
  *   N<int>  Line number of the command, if any
  *   P<int>  Planner space remaining
  *   B<int>  Block queue space remaining
+ *
+ * If SERIAL_BYTE_CREDITS is enabled also include:
+ *   C<int>  Characters read from the serial buffer since the last "ok"
  */
 void ok_to_send() {
   refresh_cmd_timeout();
-  if (!send_ok[cmd_queue_index_r]) return;
+  if (!COMMAND_SENDS_OK()) return;
   SERIAL_PROTOCOLPGM(MSG_OK);
   #if ENABLED(ADVANCED_OK)
-    char* p = command_queue[cmd_queue_index_r];
+    #if ENABLED(PACKED_COMMAND_QUEUE)
+      char* p = &command_queue[cmd_queue_index_r + 1];
+    #else
+      char* p = command_queue[cmd_queue_index_r];
+    #endif
     if (*p == 'N') {
       SERIAL_PROTOCOL(' ');
       SERIAL_ECHO(*p++);
@@ -8730,11 +9339,79 @@ void ok_to_send() {
         SERIAL_ECHO(*p++);
     }
     SERIAL_PROTOCOLPGM(" P"); SERIAL_PROTOCOL(int(BLOCK_BUFFER_SIZE - planner.movesplanned() - 1));
-    SERIAL_PROTOCOLPGM(" B"); SERIAL_PROTOCOL(BUFSIZE - commands_in_queue);
+    #if ENABLED(PACKED_COMMAND_QUEUE)
+      // Full-length commands that are sure to fit
+      SERIAL_PROTOCOLPGM(" B"); SERIAL_PROTOCOL(int(command_queue_free_bytes() / ((MAX_CMD_SIZE) + 1)));
+    #else
+      SERIAL_PROTOCOLPGM(" B"); SERIAL_PROTOCOL(BUFSIZE - commands_in_queue);
+    #endif
+  #endif
+  #if ENABLED(SERIAL_BYTE_CREDITS)
+    report_serial_credits();
   #endif
   SERIAL_EOL;
 }
 
+#if ENABLED(BINARY_MOVE_PROTOCOL)
+
+  /**
+   * Run the received binary frame as a relative G1
+   */
+  void process_binary_move() {
+    binary_move_pending = false;
+
+    const uint8_t flags = binary_frame[2], size = binary_delta_size(flags);
+    const uint8_t *p = &binary_frame[3];
+    LOOP_XYZE(i) {
+      if (TEST(flags, i)) {
+        // Continue from wherever G-code left the axis
+        if (current_position[i] != binary_position[i] / float(BINARY_MOVE_UNITS))
+          binary_position[i] = lround(current_position[i] * (BINARY_MOVE_UNITS));
+        switch (size) {
+          case 1: binary_position[i] += (int8_t)*p; break;
+          case 2: { int16_t d; memcpy(&d, p, 2); binary_position[i] += d; } break;
+          default: { int32_t d; memcpy(&d, p, 4); binary_position[i] += d; } break;
+        }
+        p += size;
+        destination[i] = binary_position[i] / float(BINARY_MOVE_UNITS);
+      }
+      else
+        destination[i] = current_position[i]; // Rounding would make a tiny move
+    }
+
+    if (TEST(flags, 4)) {
+      uint16_t f;
+      memcpy(&f, p, 2);
+      if (f) feedrate_mm_s = MMM_TO_MMS(f);
+    }
+
+    if (IsRunning()) {
+      #if ENABLED(PRINTCOUNTER)
+        if (!DEBUGGING(DRYRUN))
+          print_job_timer.incFilamentUsed(destination[E_AXIS] - current_position[E_AXIS]);
+      #endif
+
+      KEEPALIVE_STATE(IN_HANDLER);
+      #if ENABLED(SEGMENT_COALESCING)
+        coalesce_next_move = true;
+        prepare_move_to_destination();
+        coalesce_next_move = false;
+      #else
+        prepare_move_to_destination();
+      #endif
+      KEEPALIVE_STATE(NOT_BUSY);
+    }
+
+    refresh_cmd_timeout();
+    SERIAL_PROTOCOLPGM(MSG_OK);
+    #if ENABLED(SERIAL_BYTE_CREDITS)
+      report_serial_credits();
+    #endif
+    SERIAL_EOL;
+  }
+
+#endif // BINARY_MOVE_PROTOCOL
+
 #if ENABLED(min_software_endstops) || ENABLED(max_software_endstops)
 
   /**
@@ -9388,6 +10065,22 @@ void set_current_from_steppers_for_axis(const AxisEnum axis) {
    * If Mesh Bed Leveling is enabled, perform a mesh move.
    */
   inline bool prepare_move_to_destination_cartesian() {
+    #if ENABLED(SEGMENT_COALESCING)
+      // Hold G0/G1 moves that would go straight to the planner
+      if (coalesce_next_move
+        && (current_position[X_AXIS] != destination[X_AXIS] || current_position[Y_AXIS] != destination[Y_AXIS])
+        #if ENABLED(MESH_BED_LEVELING)
+          && !mbl.active()
+        #elif ENABLED(AUTO_BED_LEVELING_BILINEAR)
+          && !planner.abl_enabled
+        #endif
+      ) {
+        coalesce_move(MMS_SCALED(feedrate_mm_s));
+        return true;
+      }
+      flush_coalesced_move();
+    #endif
+
     // Do not use feedrate_percentage for E or Z only moves
     if (current_position[X_AXIS] == destination[X_AXIS] && current_position[Y_AXIS] == destination[Y_AXIS]) {
       line_to_destination();
@@ -9937,7 +10630,7 @@ void manage_inactivity(bool ignore_stepper_queue/*=false*/) {
       handle_filament_runout();
   #endif
 
-  if (commands_in_queue < BUFSIZE) get_available_commands();
+  if (COMMAND_QUEUE_HAS_SPACE()) get_available_commands();
 
   millis_t ms = millis();
 
@@ -10113,6 +10806,30 @@ void idle(
     bool no_stepper_sleep/*=false*/
   #endif
 ) {
+  #if ENABLED(STEP_SEGMENT_BUFFER)
+    stepper.prepare_segments();
+
+    // Report the stepper running out of segments
+    static uint16_t underruns_reported = 0;
+    CRITICAL_SECTION_START;
+      const uint16_t underruns = stepper.segment_underruns;
+    CRITICAL_SECTION_END;
+    if (underruns != underruns_reported) {
+      underruns_reported = underruns;
+      SERIAL_ERROR_START;
+      SERIAL_ERRORPGM(MSG_ERR_SEGMENT_UNDERRUN);
+      SERIAL_ERRORLN(underruns);
+    }
+  #endif
+
+  #if ENABLED(REALTIME_COMMANDS)
+    if (realtime_status_requested && tx_line_start) report_realtime_status();
+  #endif
+
+  #if ENABLED(PLANNER_PROFILING)
+    planner.profile_dump();
+  #endif
+
   lcd_update();
 
   host_keepalive();
@@ -10254,7 +10971,9 @@ void setup() {
   SERIAL_ECHOLNPAIR(MSG_PLANNER_BUFFER_BYTES, (int)sizeof(block_t)*BLOCK_BUFFER_SIZE);
 
   // Send "ok" after commands by default
-  for (int8_t i = 0; i < BUFSIZE; i++) send_ok[i] = true;
+  #if DISABLED(PACKED_COMMAND_QUEUE)
+    for (int8_t i = 0; i < BUFSIZE; i++) send_ok[i] = true;
+  #endif
 
   // Load data from EEPROM if available (or use defaults)
   // This also updates variables in the planner, elsewhere
@@ -10365,7 +11084,7 @@ void setup() {
  *  - Call LCD update
  */
 void loop() {
-  if (commands_in_queue < BUFSIZE) get_available_commands();
+  if (COMMAND_QUEUE_HAS_SPACE()) get_available_commands();
 
   #if ENABLED(SDSUPPORT)
     card.checkautostart(false);
@@ -10376,7 +11095,13 @@ void loop() {
     #if ENABLED(SDSUPPORT)
 
       if (card.saving) {
-        char* command = command_queue[cmd_queue_index_r];
+        #if ENABLED(PARSED_COMMAND_QUEUE)
+          char* command = command_text[command_text_index_r];
+        #elif ENABLED(PACKED_COMMAND_QUEUE)
+          char* command = &command_queue[cmd_queue_index_r + 1];
+        #else
+          char* command = command_queue[cmd_queue_index_r];
+        #endif
         if (strstr_P(command, PSTR("M29"))) {
           // M29 closes the file
           card.closefile();
@@ -10403,10 +11128,34 @@ void loop() {
 
     // The queue may be reset by a command handler or by code invoked by idle() within a handler
     if (commands_in_queue) {
+      #if ENABLED(PARSED_COMMAND_QUEUE)
+        if (!command_queue[cmd_queue_index_r].command_code) {
+          command_text_index_r = (command_text_index_r + 1) % (PARSED_COMMAND_TEXT_SLOTS);
+          command_texts_queued--;
+        }
+      #endif
       --commands_in_queue;
-      cmd_queue_index_r = (cmd_queue_index_r + 1) % BUFSIZE;
+      #if ENABLED(PACKED_COMMAND_QUEUE)
+        if (!commands_in_queue)
+          cmd_queue_index_r = cmd_queue_index_w = 0;
+        else {
+          cmd_queue_index_r += ((uint8_t)command_queue[cmd_queue_index_r] & ~_BV(COMMAND_SEND_OK_BIT)) + 1;
+          if (cmd_queue_index_r >= COMMAND_QUEUE_BYTES || !command_queue[cmd_queue_index_r])
+            cmd_queue_index_r = 0;
+        }
+      #else
+        cmd_queue_index_r = (cmd_queue_index_r + 1) % BUFSIZE;
+      #endif
     }
   }
+  #if ENABLED(BINARY_MOVE_PROTOCOL)
+    // Frames wait for the commands sent before them
+    else if (binary_move_pending) process_binary_move();
+  #endif
+  #if ENABLED(SEGMENT_COALESCING)
+    // Don't let the planner run dry while a move is held
+    else if (planner.movesplanned() < 3) flush_coalesced_move();
+  #endif
   endstops.report_state();
   idle();
 }
@@ -204,6 +204,20 @@
   #endif
 #endif
 
+/**
+ * SD Multiple Block Read
+ */
+#if ENABLED(SD_MULTI_BLOCK_READ) && DISABLED(SD_READ_AHEAD)
+  #error "SD_MULTI_BLOCK_READ requires SD_READ_AHEAD."
+#endif
+
+/**
+ * SD Transfer Profiling
+ */
+#if ENABLED(SD_TRANSFER_PROFILING) && DISABLED(SDSUPPORT)
+  #error "SD_TRANSFER_PROFILING requires SDSUPPORT."
+#endif
+
 /**
  * Delta requirements
  */
@@ -585,6 +599,131 @@
   #error "You can enable ADVANCE or LIN_ADVANCE, but not both."
 #endif
 
+/**
+ * S-Curve Acceleration
+ */
+#if ENABLED(S_CURVE_ACCELERATION) && ENABLED(ADVANCE)
+  #error "S_CURVE_ACCELERATION is not compatible with ADVANCE. Use LIN_ADVANCE instead."
+#endif
+
+/**
+ * Step Segment Buffer
+ */
+#if ENABLED(STEP_SEGMENT_BUFFER)
+  #if ENABLED(ADVANCE) || ENABLED(LIN_ADVANCE)
+    #error "STEP_SEGMENT_BUFFER is not compatible with ADVANCE or LIN_ADVANCE."
+  #elif ENABLED(S_CURVE_ACCELERATION)
+    #error "STEP_SEGMENT_BUFFER is not compatible with S_CURVE_ACCELERATION."
+  #elif (STEP_SEGMENT_BUFFER_SIZE) & ((STEP_SEGMENT_BUFFER_SIZE) - 1)
+    #error "STEP_SEGMENT_BUFFER_SIZE must be a power of 2."
+  #endif
+#endif
+
+/**
+ * Parsed Command Queue
+ */
+#if ENABLED(PARSED_COMMAND_QUEUE)
+  #if ENABLED(ADVANCED_OK)
+    #error "PARSED_COMMAND_QUEUE is not compatible with ADVANCED_OK."
+  #elif PARSED_COMMAND_VALUES < 1 || PARSED_COMMAND_VALUES > 26
+    #error "PARSED_COMMAND_VALUES must be from 1 to 26."
+  #elif PARSED_COMMAND_TEXT_SLOTS < 1 || PARSED_COMMAND_TEXT_SLOTS > BUFSIZE
+    #error "PARSED_COMMAND_TEXT_SLOTS must be from 1 to BUFSIZE."
+  #endif
+#endif
+
+/**
+ * Serial Byte Credits
+ */
+#if ENABLED(SERIAL_BYTE_CREDITS) && defined(USBCON)
+  #error "SERIAL_BYTE_CREDITS does not work on boards using AT90USB (USBCON) processors."
+#endif
+
+/**
+ * Receive Comment Stripping
+ */
+#if ENABLED(RX_COMMENT_STRIPPING)
+  #if defined(USBCON)
+    #error "RX_COMMENT_STRIPPING does not work on boards using AT90USB (USBCON) processors."
+  #elif ENABLED(BINARY_MOVE_PROTOCOL)
+    #error "RX_COMMENT_STRIPPING is not compatible with BINARY_MOVE_PROTOCOL."
+  #endif
+#endif
+
+/**
+ * Receive Line Framing
+ */
+#if ENABLED(RX_LINE_FRAMING)
+  #if defined(USBCON)
+    #error "RX_LINE_FRAMING does not work on boards using AT90USB (USBCON) processors."
+  #elif ENABLED(PARSED_COMMAND_QUEUE) || ENABLED(PACKED_COMMAND_QUEUE)
+    #error "RX_LINE_FRAMING is not compatible with PARSED_COMMAND_QUEUE or PACKED_COMMAND_QUEUE."
+  #elif ENABLED(BINARY_MOVE_PROTOCOL)
+    #error "RX_LINE_FRAMING is not compatible with BINARY_MOVE_PROTOCOL."
+  #endif
+#endif
+
+/**
+ * Realtime Commands
+ */
+#if ENABLED(REALTIME_COMMANDS)
+  #if defined(USBCON)
+    #error "REALTIME_COMMANDS does not work on boards using AT90USB (USBCON) processors."
+  #elif ENABLED(BINARY_MOVE_PROTOCOL)
+    #error "REALTIME_COMMANDS is not compatible with BINARY_MOVE_PROTOCOL."
+  #elif DISABLED(STEP_SEGMENT_BUFFER)
+    #error "REALTIME_COMMANDS requires STEP_SEGMENT_BUFFER for feed hold and resume."
+  #elif REALTIME_FEED_HOLD < 0xF5 || REALTIME_FEED_HOLD > 0xFD || REALTIME_RESUME < 0xF5 || REALTIME_RESUME > 0xFD
+    #error "REALTIME_FEED_HOLD and REALTIME_RESUME must be 0xF5-0xFD, which never occur in UTF-8 text."
+  #endif
+#endif
+
+/**
+ * Binary Move Protocol
+ */
+#if ENABLED(BINARY_MOVE_PROTOCOL) && !(BINARY_MOVE_UNITS > 0)
+  #error "BINARY_MOVE_UNITS must be greater than 0."
+#endif
+
+/**
+ * Packed Command Queue
+ */
+#if ENABLED(PACKED_COMMAND_QUEUE)
+  #if ENABLED(PARSED_COMMAND_QUEUE)
+    #error "PACKED_COMMAND_QUEUE is not compatible with PARSED_COMMAND_QUEUE."
+  #elif MAX_CMD_SIZE > 127
+    #error "PACKED_COMMAND_QUEUE requires MAX_CMD_SIZE of 127 or less."
+  #elif COMMAND_QUEUE_BYTES < 2 * ((MAX_CMD_SIZE) + 1) || COMMAND_QUEUE_BYTES > 32767
+    #error "COMMAND_QUEUE_BYTES must be from 2 * (MAX_CMD_SIZE + 1) to 32767."
+  #endif
+#endif
+
+/**
+ * Adaptive Multi-Axis Step Smoothing
+ */
+#if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+  #if ENABLED(ADVANCE)
+    #error "ADAPTIVE_STEP_SMOOTHING is not compatible with ADVANCE."
+  #elif ENABLED(MIXING_EXTRUDER)
+    #error "ADAPTIVE_STEP_SMOOTHING is not compatible with MIXING_EXTRUDER."
+  #elif AMASS_MAX_LEVEL < 1 || AMASS_MAX_LEVEL > 3
+    #error "AMASS_MAX_LEVEL must be from 1 to 3."
+  #endif
+#endif
+
+/**
+ * Segment Coalescing
+ */
+#if ENABLED(SEGMENT_COALESCING)
+  #if IS_KINEMATIC
+    #error "SEGMENT_COALESCING is not compatible with DELTA or SCARA."
+  #elif ENABLED(DUAL_X_CARRIAGE)
+    #error "SEGMENT_COALESCING is not compatible with DUAL_X_CARRIAGE."
+  #elif COALESCE_MAX_SEGMENTS < 2
+    #error "COALESCE_MAX_SEGMENTS must be 2 or more."
+  #endif
+#endif
+
 /**
  * Filament Width Sensor
  */
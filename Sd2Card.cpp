@@ -31,6 +31,48 @@
 #if ENABLED(SDSUPPORT)
 #include "Sd2Card.h"
 
+#if ENABLED(SD_CHECK_AND_RETRY)
+static const uint16_t crctab[] PROGMEM = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+  0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+  0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+  0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+  0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+  0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+  0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+  0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+  0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+  0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+  0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+  0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+  0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+  0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+  0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+  0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+  0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+  0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+  0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+  0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+  0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+  0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+  0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+  0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+  0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+  0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+  0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+  0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+  0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+  0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+  0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+/** Update a data block CRC16 with one more byte */
+static inline __attribute__((always_inline))
+uint16_t crcUpdate(const uint16_t crc, const uint8_t b) {
+  return pgm_read_word(&crctab[(crc >> 8 ^ b) & 0XFF]) ^ (crc << 8);
+}
+#endif
+
 //------------------------------------------------------------------------------
 #if DISABLED(SOFTWARE_SPI)
   // functions for hardware SPI
@@ -56,18 +98,45 @@
     return SPDR;
   }
   //------------------------------------------------------------------------------
-  /** SPI read data - only one call so force inline */
+  /**
+   * SPI read data - only one call so force inline
+   *
+   * Each byte's transfer is started as soon as the previous byte is taken
+   * from SPDR, so storing it (and the CRC update with SD_CHECK_AND_RETRY)
+   * happens while the next byte shifts in. Unrolled by two.
+   *
+   * \return The CRC16 of the data with SD_CHECK_AND_RETRY, otherwise zero.
+   */
   static inline __attribute__((always_inline))
-  void spiRead(uint8_t* buf, uint16_t nbyte) {
-    if (nbyte-- == 0) return;
+  uint16_t spiRead(uint8_t* buf, uint16_t nbyte) {
+    uint16_t crc = 0;
+    if (nbyte == 0) return crc;
+    const uint8_t* const last = buf + nbyte - 1;
+    #if ENABLED(SD_CHECK_AND_RETRY)
+      #define SPI_STORE(B) do{ *buf++ = B; crc = crcUpdate(crc, B); }while(0)
+    #else
+      #define SPI_STORE(B) (*buf++ = B)
+    #endif
+    #define SPI_READ_NEXT() do{ \
+        while (!TEST(SPSR, SPIF)) { /* Intentionally left empty */ } \
+        const uint8_t b = SPDR; \
+        SPDR = 0XFF; \
+        SPI_STORE(b); \
+      }while(0)
+
     SPDR = 0XFF;
-    for (uint16_t i = 0; i < nbyte; i++) {
-      while (!TEST(SPSR, SPIF)) { /* Intentionally left empty */ }
-      buf[i] = SPDR;
-      SPDR = 0XFF;
+    while (buf + 1 < last) {
+      SPI_READ_NEXT();
+      SPI_READ_NEXT();
     }
+    if (buf < last) SPI_READ_NEXT();
     while (!TEST(SPSR, SPIF)) { /* Intentionally left empty */ }
-    buf[nbyte] = SPDR;
+    const uint8_t b = SPDR;
+    SPI_STORE(b);
+
+    #undef SPI_READ_NEXT
+    #undef SPI_STORE
+    return crc;
   }
   //------------------------------------------------------------------------------
   /** SPI send a byte */
@@ -79,12 +148,16 @@
   /** SPI send block - only one call so force inline */
   static inline __attribute__((always_inline))
   void spiSendBlock(uint8_t token, const uint8_t* buf) {
+    const uint8_t* const end = buf + 512;
     SPDR = token;
-    for (uint16_t i = 0; i < 512; i += 2) {
+    while (buf < end) {
+      // fetch the next two bytes while the previous one shifts out
+      const uint8_t b0 = buf[0], b1 = buf[1];
+      buf += 2;
       while (!TEST(SPSR, SPIF)) { /* Intentionally left empty */ }
-      SPDR = buf[i];
+      SPDR = b0;
       while (!TEST(SPSR, SPIF)) { /* Intentionally left empty */ }
-      SPDR = buf[i + 1];
+      SPDR = b1;
     }
     while (!TEST(SPSR, SPIF)) { /* Intentionally left empty */ }
   }
@@ -120,10 +193,19 @@
     return data;
   }
   //------------------------------------------------------------------------------
-  /** Soft SPI read data */
-  static void spiRead(uint8_t* buf, uint16_t nbyte) {
-    for (uint16_t i = 0; i < nbyte; i++)
+  /**
+   * Soft SPI read data
+   * \return The CRC16 of the data with SD_CHECK_AND_RETRY, otherwise zero.
+   */
+  static uint16_t spiRead(uint8_t* buf, uint16_t nbyte) {
+    uint16_t crc = 0;
+    for (uint16_t i = 0; i < nbyte; i++) {
       buf[i] = spiRec();
+      #if ENABLED(SD_CHECK_AND_RETRY)
+        crc = crcUpdate(crc, buf[i]);
+      #endif
+    }
+    return crc;
   }
   //------------------------------------------------------------------------------
   /** Soft SPI send byte */
@@ -160,6 +242,12 @@
 //------------------------------------------------------------------------------
 // send command and return error code.  Return zero for OK
 uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg) {
+  #if ENABLED(SD_MULTI_BLOCK_READ) || ENABLED(SD_MULTI_BLOCK_WRITE)
+    // any other command ends an open multiple block transfer
+    if (stream_ == CMD18 && cmd != CMD12) readStop();
+    else if (stream_ == CMD25) writeStop();
+  #endif
+
   // select card
   chipSelectLow();
 
@@ -295,6 +383,9 @@ bool Sd2Card::eraseSingleBlockEnable() {
 bool Sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin) {
   errorCode_ = type_ = 0;
   chipSelectPin_ = chipSelectPin;
+  #if ENABLED(SD_MULTI_BLOCK_READ) || ENABLED(SD_MULTI_BLOCK_WRITE)
+    stream_ = 0;
+  #endif
   // 16-bit init start time allows over a minute
   uint16_t t0 = (uint16_t)millis();
   uint32_t arg;
@@ -425,52 +516,12 @@ bool Sd2Card::readData(uint8_t* dst) {
   return readData(dst, 512);
 }
 
-#if ENABLED(SD_CHECK_AND_RETRY)
-static const uint16_t crctab[] PROGMEM = {
-  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
-  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
-  0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
-  0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
-  0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
-  0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
-  0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
-  0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
-  0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
-  0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
-  0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
-  0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
-  0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
-  0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
-  0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
-  0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
-  0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
-  0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
-  0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
-  0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
-  0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
-  0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-  0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
-  0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
-  0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
-  0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
-  0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
-  0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
-  0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
-  0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
-  0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
-  0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
-};
-static uint16_t CRC_CCITT(const uint8_t* data, size_t n) {
-  uint16_t crc = 0;
-  for (size_t i = 0; i < n; i++) {
-    crc = pgm_read_word(&crctab[(crc >> 8 ^ data[i]) & 0XFF]) ^ (crc << 8);
-  }
-  return crc;
-}
-#endif
 
 //------------------------------------------------------------------------------
 bool Sd2Card::readData(uint8_t* dst, uint16_t count) {
+  #if ENABLED(SD_TRANSFER_PROFILING)
+    uint32_t profile_start;
+  #endif
   // wait for start block token
   uint16_t t0 = millis();
   while ((status_ = spiRec()) == 0XFF) {
@@ -483,12 +534,16 @@ bool Sd2Card::readData(uint8_t* dst, uint16_t count) {
     error(SD_CARD_ERROR_READ);
     goto fail;
   }
-  // transfer data
-  spiRead(dst, count);
-
+#if ENABLED(SD_TRANSFER_PROFILING)
+  profile_start = micros();
+#endif
 #if ENABLED(SD_CHECK_AND_RETRY)
   {
-    uint16_t calcCrc = CRC_CCITT(dst, count);
+    // transfer data, computing the CRC as it arrives
+    uint16_t calcCrc = spiRead(dst, count);
+    #if ENABLED(SD_TRANSFER_PROFILING)
+      if (count == 512) profile_block(0, profile_start);
+    #endif
     uint16_t recvCrc = spiRec() << 8;
     recvCrc |= spiRec();
     if (calcCrc != recvCrc) {
@@ -497,6 +552,11 @@ bool Sd2Card::readData(uint8_t* dst, uint16_t count) {
     }
   }
 #else
+  // transfer data
+  spiRead(dst, count);
+  #if ENABLED(SD_TRANSFER_PROFILING)
+    if (count == 512) profile_block(0, profile_start);
+  #endif
   // discard CRC
   spiRec();
   spiRec();
@@ -554,6 +614,9 @@ fail:
  * the value zero, false, is returned for failure.
  */
 bool Sd2Card::readStop() {
+  #if ENABLED(SD_MULTI_BLOCK_READ)
+    stream_ = 0;
+  #endif
   chipSelectLow();
   if (cardCommand(CMD12, 0)) {
     error(SD_CARD_ERROR_CMD12);
@@ -565,6 +628,34 @@ fail:
   chipSelectHigh();
   return false;
 }
+#if ENABLED(SD_MULTI_BLOCK_READ)
+//------------------------------------------------------------------------------
+/**
+ * Read a 512 byte block, keeping a multiple block read open for the next.
+ *
+ * Consecutive blocks are read from the open CMD18 sequence without sending
+ * a command. A block out of sequence starts a new one, and any other
+ * command sent to the card ends it.
+ *
+ * \param[in] blockNumber Logical block to be read.
+ * \param[out] dst Pointer to the location that will receive the data.
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+bool Sd2Card::readStream(uint32_t blockNumber, uint8_t* dst) {
+  if (stream_ != CMD18 || blockNumber != streamBlock_) {
+    if (!readStart(blockNumber)) return readBlock(blockNumber, dst);
+    stream_ = CMD18;
+  }
+  if (readData(dst)) {
+    streamBlock_ = blockNumber + 1;
+    return true;
+  }
+  // end the stream and try the block on its own
+  readStop();
+  return readBlock(blockNumber, dst);
+}
+#endif
 //------------------------------------------------------------------------------
 /**
  * Set the SPI clock rate.
@@ -652,7 +743,13 @@ fail:
 //------------------------------------------------------------------------------
 // send one block of data for write block or write multiple blocks
 bool Sd2Card::writeData(uint8_t token, const uint8_t* src) {
-  spiSendBlock(token, src);
+  #if ENABLED(SD_TRANSFER_PROFILING)
+    const uint32_t profile_start = micros();
+    spiSendBlock(token, src);
+    profile_block(1, profile_start);
+  #else
+    spiSendBlock(token, src);
+  #endif
 
   spiSend(0xff);  // dummy crc
   spiSend(0xff);  // dummy crc
@@ -704,6 +801,9 @@ fail:
  * the value zero, false, is returned for failure.
  */
 bool Sd2Card::writeStop() {
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    stream_ = 0;
+  #endif
   chipSelectLow();
   if (!waitNotBusy(SD_WRITE_TIMEOUT)) goto fail;
   spiSend(STOP_TRAN_TOKEN);
@@ -716,4 +816,79 @@ fail:
   return false;
 }
 
+#if ENABLED(SD_MULTI_BLOCK_WRITE)
+//------------------------------------------------------------------------------
+/**
+ * Write a 512 byte block, keeping a multiple block write open for the next.
+ *
+ * Consecutive blocks are written to the open CMD25 sequence without
+ * sending a command. A block out of sequence starts a new one, and any
+ * other command sent to the card ends it.
+ *
+ * \param[in] blockNumber Logical block to be written.
+ * \param[in] src Pointer to the location of the data to be written.
+ * \param[in] eraseCount The number of blocks to pre-erase if a new
+ * sequence is started, from this block on.
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+bool Sd2Card::writeStream(uint32_t blockNumber, const uint8_t* src, uint32_t eraseCount) {
+  if (stream_ != CMD25 || blockNumber != streamBlock_) {
+    if (!writeStart(blockNumber, eraseCount)) return writeBlock(blockNumber, src);
+    stream_ = CMD25;
+  }
+  if (writeData(src)) {
+    streamBlock_ = blockNumber + 1;
+    return true;
+  }
+  // end the stream and try the block on its own
+  writeStop();
+  return writeBlock(blockNumber, src);
+}
+#endif
+
+#if ENABLED(SD_TRANSFER_PROFILING)
+//------------------------------------------------------------------------------
+uint32_t Sd2Card::profile_blocks[2] = { 0 },
+         Sd2Card::profile_us[2] = { 0 };
+uint16_t Sd2Card::profile_min_us[2] = { 0xFFFF, 0xFFFF },
+         Sd2Card::profile_max_us[2] = { 0 };
+
+/** Time the SPI transfer of one 512 byte block, not the token wait */
+void Sd2Card::profile_block(const uint8_t write, const uint32_t start) {
+  const uint16_t us = micros() - start;
+  profile_blocks[write]++;
+  profile_us[write] += us;
+  NOMORE(profile_min_us[write], us);
+  NOLESS(profile_max_us[write], us);
+}
+
+void Sd2Card::profile_reset() {
+  ZERO(profile_blocks);
+  ZERO(profile_us);
+  profile_min_us[0] = profile_min_us[1] = 0xFFFF;
+  ZERO(profile_max_us);
+}
+
+/**
+ * Report the block transfer times since the last reset in microseconds,
+ * with the average CPU cycles spent per byte. At the full SPI rate one
+ * byte takes 16 cycles on the wire, so that is the floor. Interrupts
+ * taken during a transfer are included, so the minimum is the clean figure.
+ */
+void Sd2Card::profile_report() {
+  for (uint8_t i = 0; i < 2; i++) {
+    const uint32_t count = profile_blocks[i];
+    const float avg = count ? (float)profile_us[i] / count : 0.0;
+    SERIAL_ECHO_START;
+    if (i) SERIAL_ECHOPGM("SD block writes:"); else SERIAL_ECHOPGM("SD block reads:");
+    SERIAL_ECHO((unsigned long)count);
+    SERIAL_ECHOPAIR(" avg:", avg);
+    SERIAL_ECHOPAIR(" min:", (unsigned long)(count ? profile_min_us[i] : 0));
+    SERIAL_ECHOPAIR(" max:", (unsigned long)profile_max_us[i]);
+    SERIAL_ECHOLNPAIR(" cycles/byte:", avg * (F_CPU / 1000000UL) / 512);
+  }
+}
+#endif // SD_TRANSFER_PROFILING
+
 #endif
@@ -214,6 +214,9 @@ class Sd2Card {
   bool readData(uint8_t* dst);
   bool readStart(uint32_t blockNumber);
   bool readStop();
+  #if ENABLED(SD_MULTI_BLOCK_READ)
+    bool readStream(uint32_t blockNumber, uint8_t* dst);
+  #endif
   bool setSckRate(uint8_t sckRateID);
   /** Return the card type: SD V1, SD V2 or SDHC
    * \return 0 - SD V1, 1 - SD V2, or 3 - SDHC.
@@ -223,6 +226,13 @@ class Sd2Card {
   bool writeData(const uint8_t* src);
   bool writeStart(uint32_t blockNumber, uint32_t eraseCount);
   bool writeStop();
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    bool writeStream(uint32_t blockNumber, const uint8_t* src, uint32_t eraseCount);
+  #endif
+  #if ENABLED(SD_TRANSFER_PROFILING)
+    static void profile_reset();
+    static void profile_report();
+  #endif
  private:
   //----------------------------------------------------------------------------
   uint8_t chipSelectPin_;
@@ -230,6 +240,18 @@ class Sd2Card {
   uint8_t spiRate_;
   uint8_t status_;
   uint8_t type_;
+  #if ENABLED(SD_MULTI_BLOCK_READ) || ENABLED(SD_MULTI_BLOCK_WRITE)
+    uint8_t stream_;        // CMD18 or CMD25 while a multiple block transfer is open, else 0
+    uint32_t streamBlock_;  // The next block it will transfer
+  #endif
+  #if ENABLED(SD_TRANSFER_PROFILING)
+    // Block transfers timed since the last reset, [0] reads and [1] writes
+    static uint32_t profile_blocks[2],
+                    profile_us[2];        // Their total duration in microseconds
+    static uint16_t profile_min_us[2],
+                    profile_max_us[2];
+    static void profile_block(const uint8_t write, const uint32_t start);
+  #endif
   // private functions
   uint8_t cardAcmd(uint8_t cmd, uint32_t arg) {
     cardCommand(CMD55, 0);
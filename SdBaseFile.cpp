@@ -39,13 +39,28 @@ void (*SdBaseFile::dateTime_)(uint16_t* date, uint16_t* time) = 0;
 //------------------------------------------------------------------------------
 // add a cluster to a file
 bool SdBaseFile::addCluster() {
-  if (!vol_->allocContiguous(1, &curCluster_)) goto fail;
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    // claim a contiguous run for streamed writes, the longest free one if none is that long
+    uint32_t count = isFile() && reserveClusters_ ? reserveClusters_ : 1;
+    if (count > 1) {
+      if (!vol_->allocLongest(&count, &curCluster_)) goto fail;
+    }
+    else if (!vol_->allocContiguous(1, &curCluster_)) goto fail;
+    reserveEnd_ = vol_->clusterStartBlock(curCluster_) + (count << vol_->clusterSizeShift_);
+  #else
+    if (!vol_->allocContiguous(1, &curCluster_)) goto fail;
+  #endif
 
   // if first cluster of file link to directory entry
   if (firstCluster_ == 0) {
     firstCluster_ = curCluster_;
     flags_ |= F_FILE_DIR_DIRTY;
   }
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    // write the chain and directory entry out now, so a run claimed ahead
+    // of the data stays part of the file if it is never closed
+    if (count > 1 && !sync()) goto fail;
+  #endif
   return true;
 
  fail:
@@ -774,6 +789,10 @@ bool SdBaseFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag) {
   // save open flags for read/write
   flags_ = oflag & F_OFLAG;
 
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    reserveClusters_ = 0;
+  #endif
+
   // set to start of file
   curCluster_ = 0;
   curPosition_ = 0;
@@ -1089,7 +1108,11 @@ int16_t SdBaseFile::read(void* buf, uint16_t nbyte) {
 
     // no buffering needed if n == 512
     if (n == 512 && block != vol_->cacheBlockNumber()) {
-      if (!vol_->readBlock(block, dst)) goto fail;
+      #if ENABLED(SD_MULTI_BLOCK_READ)
+        if (!vol_->readStream(block, dst)) goto fail;
+      #else
+        if (!vol_->readBlock(block, dst)) goto fail;
+      #endif
     }
     else {
       // read block to cache and copy data to caller
@@ -1439,6 +1462,33 @@ SdBaseFile::SdBaseFile(const char* path, uint8_t oflag) {
   writeError = false;
   open(path, oflag);
 }
+#if ENABLED(SD_MULTI_BLOCK_WRITE)
+//------------------------------------------------------------------------------
+/** Claim clusters for writing in contiguous runs, so whole blocks can be
+ * streamed to the card with few interruptions for FAT updates.
+ *
+ * \param[in] size The bytes to claim at a time, or 0 for one cluster.
+ */
+void SdBaseFile::reserve(uint32_t size) {
+  reserveClusters_ = size ? ((size - 1) >> (vol_->clusterSizeShift_ + 9)) + 1 : 0;
+}
+//------------------------------------------------------------------------------
+/** Free the clusters claimed past the end of the file and stop claiming runs.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+bool SdBaseFile::freeReserved() {
+  reserveClusters_ = 0;
+  if (fileSize_) return truncate(fileSize_);
+  if (firstCluster_) {
+    if (!vol_->freeChain(firstCluster_)) return false;
+    firstCluster_ = curCluster_ = 0;
+    flags_ |= F_FILE_DIR_DIRTY;
+  }
+  return sync();
+}
+#endif
 //------------------------------------------------------------------------------
 /** Sets a file's position.
  *
@@ -1776,7 +1826,12 @@ int16_t SdBaseFile::write(const void* buf, uint16_t nbyte) {
         // invalidate cache if block is in cache
         vol_->cacheSetBlockNumber(0XFFFFFFFF, false);
       }
-      if (!vol_->writeBlock(block, src)) goto fail;
+      #if ENABLED(SD_MULTI_BLOCK_WRITE)
+        // pre-erase the rest of the run when a new sequence starts
+        if (!vol_->writeStream(block, src, block < reserveEnd_ ? reserveEnd_ - block : 1)) goto fail;
+      #else
+        if (!vol_->writeBlock(block, src)) goto fail;
+      #endif
     }
     else {
       if (blockOffset == 0 && curPosition_ >= fileSize_) {
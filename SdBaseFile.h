@@ -292,6 +292,10 @@ class SdBaseFile {
   bool printName();
   int16_t read();
   int16_t read(void* buf, uint16_t nbyte);
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    void reserve(uint32_t size);
+    bool freeReserved();
+  #endif
   int8_t readDir(dir_t* dir, char* longFilename);
   static bool remove(SdBaseFile* dirFile, const char* path);
   bool remove();
@@ -354,6 +358,10 @@ class SdBaseFile {
   uint32_t  fileSize_;      // file size in bytes
   uint32_t  firstCluster_;  // first cluster of file
   SdVolume* vol_;           // volume where file is located
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    uint32_t reserveClusters_;  // clusters to claim at a time for streamed writes
+    uint32_t reserveEnd_;       // block after the last run of clusters claimed
+  #endif
 
   /** experimental don't use */
   bool openParent(SdBaseFile* dir);
@@ -38,7 +38,17 @@
   Sd2Card* SdVolume::sdCard_;            // pointer to SD card object
   bool     SdVolume::cacheDirty_;        // cacheFlush() will write block if true
   uint32_t SdVolume::cacheMirrorBlock_;  // mirror  block for second FAT
+  #if ENABLED(SD_FAT_CACHE)
+    // FAT block cache
+    uint32_t SdVolume::fatCacheBlockNumber_;
+    cache_t  SdVolume::fatCacheBuffer_;
+    bool     SdVolume::fatCacheDirty_;
+  #endif
 #endif  // USE_MULTIPLE_CARDS
+#if ENABLED(SD_TRANSFER_PROFILING)
+  uint32_t SdVolume::profile_hits[2] = { 0 },
+           SdVolume::profile_misses[2] = { 0 };
+#endif
 //------------------------------------------------------------------------------
 // find a contiguous group of clusters
 bool SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
@@ -91,6 +101,60 @@ bool SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
       break;
     }
   }
+  if (!chainClusters(bgnCluster, endCluster, curCluster)) goto fail;
+
+  // remember possible next free cluster
+  if (setStart) allocSearchStart_ = bgnCluster + 1;
+
+  return true;
+fail:
+  return false;
+}
+#if ENABLED(SD_MULTI_BLOCK_WRITE)
+//------------------------------------------------------------------------------
+// find a contiguous group of *count clusters, or the longest free one if
+// there is none that long, in a single pass over the FAT
+bool SdVolume::allocLongest(uint32_t* count, uint32_t* curCluster) {
+  // last cluster of FAT
+  uint32_t fatEnd = clusterCount_ + 1;
+  // start of group, try to make file contiguous
+  uint32_t bgnCluster = *curCluster ? *curCluster + 1 : allocSearchStart_;
+  // end of group
+  uint32_t endCluster = bgnCluster;
+  // longest group so far
+  uint32_t bestCluster = 0, bestCount = 0;
+
+  for (uint32_t n = 0; n < clusterCount_; n++, endCluster++) {
+    // past end - start from beginning of FAT
+    if (endCluster > fatEnd) {
+      bgnCluster = endCluster = 2;
+    }
+    uint32_t f;
+    if (!fatGet(endCluster, &f)) goto fail;
+
+    if (f != 0) {
+      // cluster in use try next cluster as bgnCluster
+      bgnCluster = endCluster + 1;
+    }
+    else if (endCluster - bgnCluster + 1 > bestCount) {
+      bestCluster = bgnCluster;
+      bestCount = endCluster - bgnCluster + 1;
+      // done - found all the space asked for
+      if (bestCount == *count) break;
+    }
+  }
+  if (!bestCount) goto fail;
+
+  *count = bestCount;
+  return chainClusters(bestCluster, bestCluster + bestCount - 1, curCluster);
+fail:
+  return false;
+}
+#endif
+//------------------------------------------------------------------------------
+// link the free clusters bgnCluster through endCluster into a chain and
+// connect it to the chain ending at *curCluster, if any
+bool SdVolume::chainClusters(uint32_t bgnCluster, uint32_t endCluster, uint32_t* curCluster) {
   // mark end of chain
   if (!fatPutEOC(endCluster)) goto fail;
 
@@ -106,9 +170,6 @@ bool SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
   // return first cluster number to caller
   *curCluster = bgnCluster;
 
-  // remember possible next free cluster
-  if (setStart) allocSearchStart_ = bgnCluster + 1;
-
   return true;
 fail:
   return false;
@@ -119,31 +180,86 @@ bool SdVolume::cacheFlush() {
     if (!sdCard_->writeBlock(cacheBlockNumber_, cacheBuffer_.data)) {
       goto fail;
     }
-    // mirror FAT tables
-    if (cacheMirrorBlock_) {
-      if (!sdCard_->writeBlock(cacheMirrorBlock_, cacheBuffer_.data)) {
-        goto fail;
+    #if DISABLED(SD_FAT_CACHE)
+      // mirror FAT tables
+      if (cacheMirrorBlock_) {
+        if (!sdCard_->writeBlock(cacheMirrorBlock_, cacheBuffer_.data)) {
+          goto fail;
+        }
+        cacheMirrorBlock_ = 0;
       }
-      cacheMirrorBlock_ = 0;
-    }
+    #endif
     cacheDirty_ = 0;
   }
-  return true;
+  #if ENABLED(SD_FAT_CACHE)
+    return fatCacheFlush();
+  #else
+    return true;
+  #endif
 fail:
   return false;
 }
 //------------------------------------------------------------------------------
 bool SdVolume::cacheRawBlock(uint32_t blockNumber, bool dirty) {
   if (cacheBlockNumber_ != blockNumber) {
+    #if ENABLED(SD_TRANSFER_PROFILING)
+      profile_misses[0]++;
+    #endif
     if (!cacheFlush()) goto fail;
     if (!sdCard_->readBlock(blockNumber, cacheBuffer_.data)) goto fail;
     cacheBlockNumber_ = blockNumber;
   }
+  #if ENABLED(SD_TRANSFER_PROFILING)
+    else
+      profile_hits[0]++;
+  #endif
   if (dirty) cacheDirty_ = true;
   return true;
 fail:
   return false;
 }
+#if ENABLED(SD_FAT_CACHE)
+//------------------------------------------------------------------------------
+// Write the FAT cache block and its mirror if it was changed
+bool SdVolume::fatCacheFlush() {
+  if (fatCacheDirty_) {
+    if (!sdCard_->writeBlock(fatCacheBlockNumber_, fatCacheBuffer_.data)) {
+      goto fail;
+    }
+    // mirror FAT tables
+    if (cacheMirrorBlock_) {
+      if (!sdCard_->writeBlock(cacheMirrorBlock_, fatCacheBuffer_.data)) {
+        goto fail;
+      }
+      cacheMirrorBlock_ = 0;
+    }
+    fatCacheDirty_ = 0;
+  }
+  return true;
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+// Read a FAT block into the FAT cache, so it doesn't evict the data block
+bool SdVolume::cacheFatBlock(uint32_t blockNumber, bool dirty) {
+  if (fatCacheBlockNumber_ != blockNumber) {
+    #if ENABLED(SD_TRANSFER_PROFILING)
+      profile_misses[1]++;
+    #endif
+    if (!fatCacheFlush()) goto fail;
+    if (!sdCard_->readBlock(blockNumber, fatCacheBuffer_.data)) goto fail;
+    fatCacheBlockNumber_ = blockNumber;
+  }
+  #if ENABLED(SD_TRANSFER_PROFILING)
+    else
+      profile_hits[1]++;
+  #endif
+  if (dirty) fatCacheDirty_ = true;
+  return true;
+fail:
+  return false;
+}
+#endif
 //------------------------------------------------------------------------------
 // return the size in bytes of a cluster chain
 bool SdVolume::chainSize(uint32_t cluster, uint32_t* size) {
@@ -166,15 +282,15 @@ bool SdVolume::fatGet(uint32_t cluster, uint32_t* value) {
     uint16_t index = cluster;
     index += index >> 1;
     lba = fatStartBlock_ + (index >> 9);
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) goto fail;
+    if (!cacheFatBlock(lba, CACHE_FOR_READ)) goto fail;
     index &= 0X1FF;
-    uint16_t tmp = cacheBuffer_.data[index];
+    uint16_t tmp = fatCache()->data[index];
     index++;
     if (index == 512) {
-      if (!cacheRawBlock(lba + 1, CACHE_FOR_READ)) goto fail;
+      if (!cacheFatBlock(lba + 1, CACHE_FOR_READ)) goto fail;
       index = 0;
     }
-    tmp |= cacheBuffer_.data[index] << 8;
+    tmp |= fatCache()->data[index] << 8;
     *value = cluster & 1 ? tmp >> 4 : tmp & 0XFFF;
     return true;
   }
@@ -187,14 +303,12 @@ bool SdVolume::fatGet(uint32_t cluster, uint32_t* value) {
   else {
     goto fail;
   }
-  if (lba != cacheBlockNumber_) {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) goto fail;
-  }
+  if (!cacheFatBlock(lba, CACHE_FOR_READ)) goto fail;
   if (fatType_ == 16) {
-    *value = cacheBuffer_.fat16[cluster & 0XFF];
+    *value = fatCache()->fat16[cluster & 0XFF];
   }
   else {
-    *value = cacheBuffer_.fat32[cluster & 0X7F] & FAT32MASK;
+    *value = fatCache()->fat32[cluster & 0X7F] & FAT32MASK;
   }
   return true;
 fail:
@@ -214,28 +328,28 @@ bool SdVolume::fatPut(uint32_t cluster, uint32_t value) {
     uint16_t index = cluster;
     index += index >> 1;
     lba = fatStartBlock_ + (index >> 9);
-    if (!cacheRawBlock(lba, CACHE_FOR_WRITE)) goto fail;
+    if (!cacheFatBlock(lba, CACHE_FOR_WRITE)) goto fail;
     // mirror second FAT
     if (fatCount_ > 1) cacheMirrorBlock_ = lba + blocksPerFat_;
     index &= 0X1FF;
     uint8_t tmp = value;
     if (cluster & 1) {
-      tmp = (cacheBuffer_.data[index] & 0XF) | tmp << 4;
+      tmp = (fatCache()->data[index] & 0XF) | tmp << 4;
     }
-    cacheBuffer_.data[index] = tmp;
+    fatCache()->data[index] = tmp;
     index++;
     if (index == 512) {
       lba++;
       index = 0;
-      if (!cacheRawBlock(lba, CACHE_FOR_WRITE)) goto fail;
+      if (!cacheFatBlock(lba, CACHE_FOR_WRITE)) goto fail;
       // mirror second FAT
       if (fatCount_ > 1) cacheMirrorBlock_ = lba + blocksPerFat_;
     }
     tmp = value >> 4;
     if (!(cluster & 1)) {
-      tmp = ((cacheBuffer_.data[index] & 0XF0)) | tmp >> 4;
+      tmp = ((fatCache()->data[index] & 0XF0)) | tmp >> 4;
     }
-    cacheBuffer_.data[index] = tmp;
+    fatCache()->data[index] = tmp;
     return true;
   }
   if (fatType_ == 16) {
@@ -247,13 +361,13 @@ bool SdVolume::fatPut(uint32_t cluster, uint32_t value) {
   else {
     goto fail;
   }
-  if (!cacheRawBlock(lba, CACHE_FOR_WRITE)) goto fail;
+  if (!cacheFatBlock(lba, CACHE_FOR_WRITE)) goto fail;
   // store entry
   if (fatType_ == 16) {
-    cacheBuffer_.fat16[cluster & 0XFF] = value;
+    fatCache()->fat16[cluster & 0XFF] = value;
   }
   else {
-    cacheBuffer_.fat32[cluster & 0X7F] = value;
+    fatCache()->fat32[cluster & 0X7F] = value;
   }
   // mirror second FAT
   if (fatCount_ > 1) cacheMirrorBlock_ = lba + blocksPerFat_;
@@ -304,16 +418,16 @@ int32_t SdVolume::freeClusterCount() {
   }
 
   for (uint32_t lba = fatStartBlock_; todo; todo -= n, lba++) {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) return -1;
+    if (!cacheFatBlock(lba, CACHE_FOR_READ)) return -1;
     NOMORE(n, todo);
     if (fatType_ == 16) {
       for (uint16_t i = 0; i < n; i++) {
-        if (cacheBuffer_.fat16[i] == 0) free++;
+        if (fatCache()->fat16[i] == 0) free++;
       }
     }
     else {
       for (uint16_t i = 0; i < n; i++) {
-        if (cacheBuffer_.fat32[i] == 0) free++;
+        if (fatCache()->fat32[i] == 0) free++;
       }
     }
   }
@@ -345,6 +459,10 @@ bool SdVolume::init(Sd2Card* dev, uint8_t part) {
   cacheDirty_ = 0;  // cacheFlush() will write block if true
   cacheMirrorBlock_ = 0;
   cacheBlockNumber_ = 0XFFFFFFFF;
+  #if ENABLED(SD_FAT_CACHE)
+    fatCacheDirty_ = 0;
+    fatCacheBlockNumber_ = 0XFFFFFFFF;
+  #endif
 
   // if part == 0 assume super floppy with FAT boot sector in block zero
   // if part > 0 assume mbr volume with partition table
@@ -417,4 +535,28 @@ bool SdVolume::init(Sd2Card* dev, uint8_t part) {
 fail:
   return false;
 }
+
+#if ENABLED(SD_TRANSFER_PROFILING)
+//------------------------------------------------------------------------------
+void SdVolume::profile_reset() {
+  ZERO(profile_hits);
+  ZERO(profile_misses);
+}
+
+/**
+ * Report how often a block was found in the data and FAT caches since
+ * the last reset. Without SD_FAT_CACHE, FAT blocks share the data cache.
+ */
+void SdVolume::profile_report() {
+  for (uint8_t i = 0; i < 2; i++) {
+    #if DISABLED(SD_FAT_CACHE)
+      if (i) break;
+    #endif
+    SERIAL_ECHO_START;
+    if (i) SERIAL_ECHOPGM("FAT cache hits:"); else SERIAL_ECHOPGM("Block cache hits:");
+    SERIAL_ECHO((unsigned long)profile_hits[i]);
+    SERIAL_ECHOLNPAIR(" misses:", (unsigned long)profile_misses[i]);
+  }
+}
+#endif // SD_TRANSFER_PROFILING
 #endif
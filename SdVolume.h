@@ -126,6 +126,10 @@ class SdVolume {
    * \return true for success or false for failure
    */
   bool dbgFat(uint32_t n, uint32_t* v) {return fatGet(n, v);}
+#if ENABLED(SD_TRANSFER_PROFILING)
+  static void profile_reset();
+  static void profile_report();
+#endif
   //------------------------------------------------------------------------------
  private:
   // Allow SdBaseFile access to SdVolume private data.
@@ -142,13 +146,27 @@ class SdVolume {
   Sd2Card* sdCard_;            // Sd2Card object for cache
   bool cacheDirty_;            // cacheFlush() will write block if true
   uint32_t cacheMirrorBlock_;  // block number for mirror FAT
+  #if ENABLED(SD_FAT_CACHE)
+    cache_t fatCacheBuffer_;        // 512 byte cache for FAT blocks only
+    uint32_t fatCacheBlockNumber_;  // Logical number of block in the FAT cache
+    bool fatCacheDirty_;            // cacheFlush() will write FAT block if true
+  #endif
 #else  // USE_MULTIPLE_CARDS
   static cache_t cacheBuffer_;        // 512 byte cache for device blocks
   static uint32_t cacheBlockNumber_;  // Logical number of block in the cache
   static Sd2Card* sdCard_;            // Sd2Card object for cache
   static bool cacheDirty_;            // cacheFlush() will write block if true
   static uint32_t cacheMirrorBlock_;  // block number for mirror FAT
+  #if ENABLED(SD_FAT_CACHE)
+    static cache_t fatCacheBuffer_;        // 512 byte cache for FAT blocks only
+    static uint32_t fatCacheBlockNumber_;  // Logical number of block in the FAT cache
+    static bool fatCacheDirty_;            // cacheFlush() will write FAT block if true
+  #endif
 #endif  // USE_MULTIPLE_CARDS
+#if ENABLED(SD_TRANSFER_PROFILING)
+  // Block lookups since the last reset, [0] data cache and [1] FAT cache
+  static uint32_t profile_hits[2], profile_misses[2];
+#endif
   uint32_t allocSearchStart_;   // start cluster for alloc search
   uint8_t blocksPerCluster_;    // cluster size in blocks
   uint32_t blocksPerFat_;       // FAT size in blocks
@@ -162,6 +180,10 @@ class SdVolume {
   uint32_t rootDirStart_;       // root start block for FAT16, cluster for FAT32
   //----------------------------------------------------------------------------
   bool allocContiguous(uint32_t count, uint32_t* curCluster);
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    bool allocLongest(uint32_t* count, uint32_t* curCluster);
+  #endif
+  bool chainClusters(uint32_t bgnCluster, uint32_t endCluster, uint32_t* curCluster);
   uint8_t blockOfCluster(uint32_t position) const {
     return (position >> 9) & (blocksPerCluster_ - 1);
   }
@@ -176,10 +198,26 @@ class SdVolume {
 #if USE_MULTIPLE_CARDS
   bool cacheFlush();
   bool cacheRawBlock(uint32_t blockNumber, bool dirty);
+  #if ENABLED(SD_FAT_CACHE)
+    bool fatCacheFlush();
+  #endif
 #else  // USE_MULTIPLE_CARDS
   static bool cacheFlush();
   static bool cacheRawBlock(uint32_t blockNumber, bool dirty);
+  #if ENABLED(SD_FAT_CACHE)
+    static bool fatCacheFlush();
+  #endif
 #endif  // USE_MULTIPLE_CARDS
+#if ENABLED(SD_FAT_CACHE)
+  // FAT blocks have a cache of their own
+  bool cacheFatBlock(uint32_t blockNumber, bool dirty);
+  cache_t* fatCache() {return &fatCacheBuffer_;}
+#else
+  bool cacheFatBlock(uint32_t blockNumber, bool dirty) {
+    return cacheRawBlock(blockNumber, dirty);
+  }
+  cache_t* fatCache() {return &cacheBuffer_;}
+#endif
   // used by SdBaseFile write to assign cache to SD location
   void cacheSetBlockNumber(uint32_t blockNumber, bool dirty) {
     cacheDirty_ = dirty;
@@ -201,9 +239,19 @@ class SdVolume {
   bool readBlock(uint32_t block, uint8_t* dst) {
     return sdCard_->readBlock(block, dst);
   }
+  #if ENABLED(SD_MULTI_BLOCK_READ)
+    bool readStream(uint32_t block, uint8_t* dst) {
+      return sdCard_->readStream(block, dst);
+    }
+  #endif
   bool writeBlock(uint32_t block, const uint8_t* dst) {
     return sdCard_->writeBlock(block, dst);
   }
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    bool writeStream(uint32_t block, const uint8_t* src, uint32_t eraseCount) {
+      return sdCard_->writeStream(block, src, eraseCount);
+    }
+  #endif
   //------------------------------------------------------------------------------
   // Deprecated functions  - suppress cpplint warnings with NOLINT comment
 #if ALLOW_DEPRECATED_FUNCTIONS && !defined(DOXYGEN)
@@ -0,0 +1,84 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (C) 2016 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * Based on Sprinter and grbl.
+ * Copyright (C) 2011 Camiel Gubbels / Erik van der Zalm
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * Integer trapezoid step counts for PLANNER_FIXED_POINT.
+ *
+ * (target² - initial²) / 2a is computed as (target - initial) * (target + initial)
+ * multiplied by a normalized inverse of 2a, which the planner works out once
+ * per block. The 96-bit product is formed from two 32x32->64 multiplies, so
+ * replanning needs no divides. Nothing here depends on the hardware, so
+ * test/acceleration_steps_test.cpp can check it against the float versions
+ * on the host.
+ */
+
+#ifndef __ACCELERATION_STEPS_H__
+#define __ACCELERATION_STEPS_H__
+
+#include <stdint.h>
+
+// The shift that normalizes 2^(32 + shift) / (2 * accel) to 32 bits: the bit
+// length of accel, so at most 32 and 2^(31 + shift) always fits in 64 bits
+inline uint8_t acceleration_steps_shift(const uint32_t accel) {
+  uint8_t shift = 0;
+  while (shift < 32 && (accel >> shift)) shift++;
+  return shift;
+}
+
+// 2^(32 + shift) / (2 * accel), rounded down. Zero for no acceleration.
+inline uint32_t acceleration_steps_inverse(const uint32_t accel, const uint8_t shift) {
+  return accel ? ((1ULL << (31 + shift)) - 1) / accel : 0;
+}
+
+/**
+ * (target_rate² - initial_rate²) / 2a, rounded down or up, for the inverse
+ * and shift of a.
+ */
+inline int32_t acceleration_steps(const uint32_t inverse, const uint8_t shift, const uint32_t initial_rate, const uint32_t target_rate, const bool round_up) {
+  if (target_rate < initial_rate) return -acceleration_steps(inverse, shift, target_rate, initial_rate, !round_up);
+
+  const uint64_t rate_sq = (uint64_t)(target_rate - initial_rate) * (target_rate + initial_rate),
+                 low = (rate_sq & 0xFFFFFFFFUL) * inverse,
+                 high = (rate_sq >> 32) * inverse + (low >> 32); // rate_sq * inverse / 2^32
+
+  uint64_t steps = high >> shift;
+  if (round_up && ((uint32_t)low || (high & ((1ULL << shift) - 1)))) steps++;
+  return steps < 0x7FFFFFFFUL ? steps : 0x7FFFFFFFUL;
+}
+
+/**
+ * The step at which to stop accelerating to reach final_rate at the end of
+ * a block of step_event_count steps, rounded up.
+ * (2a * d - initial² + final²) / 4a is the same as (d + (final² - initial²) / 2a) / 2
+ */
+inline int32_t intersection_steps(const uint32_t inverse, const uint8_t shift, const uint32_t step_event_count, const uint32_t initial_rate, const uint32_t final_rate) {
+  if (!inverse) return 0;
+  // Past +/- step_event_count the result is clamped by the planner anyway
+  const int32_t steps = step_event_count;
+  int32_t rate_steps = acceleration_steps(inverse, shift, initial_rate, final_rate, true);
+  if (rate_steps > steps) rate_steps = steps;
+  else if (rate_steps < -steps) rate_steps = -steps;
+  const uint32_t twice = step_event_count + rate_steps; // 0 to 2 * steps
+  return (twice + 1) >> 1;
+}
+
+#endif // __ACCELERATION_STEPS_H__
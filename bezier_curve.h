@@ -0,0 +1,69 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (C) 2016 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * Based on Sprinter and grbl.
+ * Copyright (C) 2011 Camiel Gubbels / Erik van der Zalm
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * S-curve step rate profile for S_CURVE_ACCELERATION.
+ *
+ * The planner sizes each curve to take as long as the linear ramp it
+ * replaces, and the stepper ISR evaluates it by elapsed timer ticks.
+ * Nothing here depends on the hardware, so test/bezier_curve_test.cpp
+ * can run blocks through it on the host and compare them with the
+ * trapezoid.
+ */
+
+#ifndef __BEZIER_CURVE_H__
+#define __BEZIER_CURVE_H__
+
+#include <stdint.h>
+#include "macros.h"
+
+// Stepper timer ticks the linear ramp from low_rate up to high_rate takes.
+// ticks_per_rate is 2^24 / the block's acceleration_rate.
+inline uint32_t bezier_ramp_time(const uint32_t low_rate, const uint32_t high_rate, const float &ticks_per_rate) {
+  return high_rate > low_rate ? (high_rate - low_rate) * ticks_per_rate : 0;
+}
+
+// 2^32 / time, so the ISR can scale elapsed ticks without a divide
+inline uint32_t bezier_time_inverse(const uint32_t time) {
+  return time ? 0xFFFFFFFFUL / time : 0xFFFFFFFFUL;
+}
+
+/**
+ * The step rate 'elapsed' timer ticks into a curve from start_rate to end_rate.
+ *
+ * The rate follows the quintic s(t) = 10t^3 - 15t^4 + 6t^5, which has zero
+ * slope and curvature at both ends and averages to the linear ramp. Its
+ * steepest slope, at the middle, is 1.875 times that of the linear ramp.
+ * t and s(t) are 16-bit fractions, so only 16x16 multiplies are needed.
+ */
+FORCE_INLINE uint16_t eval_bezier_curve(const uint16_t start_rate, const uint16_t end_rate, const uint32_t time_inverse, const uint32_t elapsed) {
+  const uint16_t t = (time_inverse * elapsed) >> 16,
+                 t2 = ((uint32_t)t * t) >> 16,
+                 t3 = ((uint32_t)t2 * t) >> 16,
+                 k = ((10UL << 16) - 15UL * t + 6UL * t2) >> 4; // 10 - 15t + 6t^2, always > 1 here
+  const uint32_t s = ((uint32_t)t3 * k) >> 12;
+  return end_rate > start_rate
+    ? start_rate + (uint16_t)(((uint32_t)(end_rate - start_rate) * s) >> 16)
+    : start_rate - (uint16_t)(((uint32_t)(start_rate - end_rate) * s) >> 16);
+}
+
+#endif // __BEZIER_CURVE_H__
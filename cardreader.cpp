@@ -222,6 +222,9 @@ void CardReader::ls()  {
 #endif // LONG_FILENAME_HOST_SUPPORT
 
 void CardReader::initsd() {
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    if (saving) closefile(); // Give back the clusters claimed ahead
+  #endif
   cardOK = false;
   if (root.isOpen()) root.close();
 
@@ -283,6 +286,9 @@ void CardReader::setroot() {
 }
 
 void CardReader::release() {
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    if (saving) closefile(); // Give back the clusters claimed ahead
+  #endif
   sdprinting = false;
   cardOK = false;
 }
@@ -291,7 +297,7 @@ void CardReader::openAndPrintFile(const char *name) {
   char cmd[4 + strlen(name) + 1]; // Room for "M23 ", filename, and null
   sprintf_P(cmd, PSTR("M23 %s"), name);
   for (char *c = &cmd[4]; *c; c++) *c = tolower(*c);
-  enqueue_and_echo_command(cmd);
+  enqueue_and_echo_command_now(cmd);
   enqueue_and_echo_commands_P(PSTR("M24"));
 }
 
@@ -417,6 +423,9 @@ void CardReader::openFile(char* name, bool read, bool push_current/*=false*/) {
       SERIAL_PROTOCOLPAIR(MSG_SD_FILE_OPENED, fname);
       SERIAL_PROTOCOLLNPAIR(MSG_SD_SIZE, filesize);
       sdpos = 0;
+      #if ENABLED(SD_READ_AHEAD)
+        block_index = read_count = 0;
+      #endif
 
       SERIAL_PROTOCOLLNPGM(MSG_SD_FILE_SELECTED);
       getfilename(0, fname);
@@ -436,6 +445,11 @@ void CardReader::openFile(char* name, bool read, bool push_current/*=false*/) {
     }
     else {
       saving = true;
+      #if ENABLED(SD_MULTI_BLOCK_WRITE)
+        file.reserve(SD_WRITE_RESERVE_KB * 1024UL);
+        block_index = 0;
+        write_start_ms = millis();
+      #endif
       SERIAL_PROTOCOLLNPAIR(MSG_SD_WRITE_TO_FILE, name);
       lcd_setstatus(fname);
     }
@@ -507,6 +521,22 @@ void CardReader::removeFile(char* name) {
   }
 }
 
+#if ENABLED(SD_READ_AHEAD)
+
+  /**
+   * Refill the read-ahead buffer. The first read runs up to the next block
+   * boundary, so every read after it is a whole block that goes straight
+   * from the card into the buffer, bypassing the volume cache.
+   */
+  bool CardReader::fill_read_buffer() {
+    int16_t n = file.read(block_buffer, 512 - (file.curPosition() & 0x1FF));
+    block_index = 0;
+    read_count = max(n, 0);
+    return n > 0;
+  }
+
+#endif
+
 void CardReader::getStatus() {
   if (cardOK) {
     SERIAL_PROTOCOLPGM(MSG_SD_PRINTING_BYTE);
@@ -532,7 +562,18 @@ void CardReader::write_command(char *buf) {
   end[1] = '\r';
   end[2] = '\n';
   end[3] = '\0';
-  file.write(begin);
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    // Gather lines into whole blocks, which are streamed to the card
+    for (const char* c = begin; *c; c++) {
+      block_buffer[block_index++] = *c;
+      if (block_index == 512) {
+        file.write(block_buffer, 512);
+        block_index = 0;
+      }
+    }
+  #else
+    file.write(begin);
+  #endif
   if (file.writeError) {
     SERIAL_ERROR_START;
     SERIAL_ERRORLNPGM(MSG_SD_ERR_WRITE_TO_FILE);
@@ -573,6 +614,24 @@ void CardReader::checkautostart(bool force) {
 }
 
 void CardReader::closefile(bool store_location) {
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    if (saving) {
+      // Write out the last partial block and give back the unused clusters
+      file.writeError = false;
+      if (block_index) file.write(block_buffer, block_index);
+      block_index = 0;
+      if (file.writeError || !file.freeReserved()) {
+        SERIAL_ERROR_START;
+        SERIAL_ERRORLNPGM(MSG_SD_ERR_WRITE_TO_FILE);
+      }
+      const millis_t ms = millis() - write_start_ms;
+      SERIAL_ECHO_START;
+      SERIAL_ECHOPAIR("Wrote ", (unsigned long)file.fileSize());
+      SERIAL_ECHOPAIR(" bytes in ", ms * 0.001);
+      SERIAL_ECHOPAIR("s, ", ms ? file.fileSize() / 1.024 / ms : 0.0);
+      SERIAL_ECHOLNPGM(" KB/s");
+    }
+  #endif
   file.sync();
   file.close();
   saving = logging = false;
@@ -82,8 +82,18 @@ public:
   FORCE_INLINE void pauseSDPrint() { sdprinting = false; }
   FORCE_INLINE bool isFileOpen() { return file.isOpen(); }
   FORCE_INLINE bool eof() { return sdpos >= filesize; }
-  FORCE_INLINE int16_t get() { sdpos = file.curPosition(); return (int16_t)file.read(); }
-  FORCE_INLINE void setIndex(long index) { sdpos = index; file.seekSet(index); }
+  #if ENABLED(SD_READ_AHEAD)
+    // sdpos is the position of the byte returned, as with file.read()
+    FORCE_INLINE int16_t get() {
+      if (block_index >= read_count && !fill_read_buffer()) { sdpos = file.curPosition(); return -1; }
+      sdpos = file.curPosition() - read_count + block_index;
+      return block_buffer[block_index++];
+    }
+    FORCE_INLINE void setIndex(long index) { sdpos = index; file.seekSet(index); block_index = read_count = 0; }
+  #else
+    FORCE_INLINE int16_t get() { sdpos = file.curPosition(); return (int16_t)file.read(); }
+    FORCE_INLINE void setIndex(long index) { sdpos = index; file.seekSet(index); }
+  #endif
   FORCE_INLINE uint8_t percentDone() { return (isFileOpen() && filesize) ? sdpos / ((filesize + 99) / 100) : 0; }
   FORCE_INLINE char* getWorkDirName() { workDir.getFilename(filename); return filename; }
 
@@ -135,6 +145,18 @@ private:
   uint32_t filesize;
   uint32_t sdpos;
 
+  #if ENABLED(SD_READ_AHEAD) || ENABLED(SD_MULTI_BLOCK_WRITE)
+    uint8_t block_buffer[512];  // Read ahead of printing, or gathered for saving
+    uint16_t block_index;       // Next byte to read or write
+  #endif
+  #if ENABLED(SD_READ_AHEAD)
+    uint16_t read_count;
+    bool fill_read_buffer();
+  #endif
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    millis_t write_start_ms;
+  #endif
+
   millis_t next_autostart_ms;
   bool autostart_stilltocheck; //the sd start is delayed, because otherwise the serial cannot answer fast enought to make contact with the hostsoftware.
 
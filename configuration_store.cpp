@@ -36,13 +36,13 @@
  *
  */
 
-#define EEPROM_VERSION "V27"
+#define EEPROM_VERSION "V28"
 
 // Change EEPROM version if these are changed:
 #define EEPROM_OFFSET 100
 
 /**
- * V27 EEPROM Layout:
+ * V28 EEPROM Layout:
  *
  *  100  Version (char x4)
  *  104  EEPROM Checksum (uint16_t)
@@ -60,64 +60,65 @@
  *  182  M205 Y    planner.max_jerk[Y_AXIS] (float)
  *  186  M205 Z    planner.max_jerk[Z_AXIS] (float)
  *  190  M205 E    planner.max_jerk[E_AXIS] (float)
- *  194  M206 XYZ  home_offset (float x3)
- *  206  M218 XYZ  hotend_offset (float x3 per additional hotend)
+ *  194  M205 J    planner.junction_deviation_mm (float)
+ *  198  M206 XYZ  home_offset (float x3)
+ *  210  M218 XYZ  hotend_offset (float x3 per additional hotend)
  *
  * Mesh bed leveling:
- *  218  M420 S    status (uint8)
- *  219            z_offset (float)
- *  223            mesh_num_x (uint8 as set in firmware)
- *  224            mesh_num_y (uint8 as set in firmware)
- *  225 G29 S3 XYZ z_values[][] (float x9, by default, up to float x 81)
+ *  222  M420 S    status (uint8)
+ *  223            z_offset (float)
+ *  227            mesh_num_x (uint8 as set in firmware)
+ *  228            mesh_num_y (uint8 as set in firmware)
+ *  229 G29 S3 XYZ z_values[][] (float x9, by default, up to float x 81)
  *
  * AUTO BED LEVELING
- *  261  M851      zprobe_zoffset (float)
+ *  265  M851      zprobe_zoffset (float)
  *
  * DELTA:
- *  265  M666 XYZ  endstop_adj (float x3)
- *  277  M665 R    delta_radius (float)
- *  281  M665 L    delta_diagonal_rod (float)
- *  285  M665 S    delta_segments_per_second (float)
- *  289  M665 A    delta_diagonal_rod_trim_tower_1 (float)
- *  293  M665 B    delta_diagonal_rod_trim_tower_2 (float)
- *  297  M665 C    delta_diagonal_rod_trim_tower_3 (float)
+ *  269  M666 XYZ  endstop_adj (float x3)
+ *  281  M665 R    delta_radius (float)
+ *  285  M665 L    delta_diagonal_rod (float)
+ *  289  M665 S    delta_segments_per_second (float)
+ *  293  M665 A    delta_diagonal_rod_trim_tower_1 (float)
+ *  297  M665 B    delta_diagonal_rod_trim_tower_2 (float)
+ *  301  M665 C    delta_diagonal_rod_trim_tower_3 (float)
  *
  * Z_DUAL_ENDSTOPS:
- *  301  M666 Z    z_endstop_adj (float)
+ *  305  M666 Z    z_endstop_adj (float)
  *
  * ULTIPANEL:
- *  305  M145 S0 H lcd_preheat_hotend_temp (int x2)
- *  309  M145 S0 B lcd_preheat_bed_temp (int x2)
- *  313  M145 S0 F lcd_preheat_fan_speed (int x2)
+ *  309  M145 S0 H lcd_preheat_hotend_temp (int x2)
+ *  313  M145 S0 B lcd_preheat_bed_temp (int x2)
+ *  317  M145 S0 F lcd_preheat_fan_speed (int x2)
  *
  * PIDTEMP:
- *  317  M301 E0 PIDC  Kp[0], Ki[0], Kd[0], Kc[0] (float x4)
- *  333  M301 E1 PIDC  Kp[1], Ki[1], Kd[1], Kc[1] (float x4)
- *  349  M301 E2 PIDC  Kp[2], Ki[2], Kd[2], Kc[2] (float x4)
- *  365  M301 E3 PIDC  Kp[3], Ki[3], Kd[3], Kc[3] (float x4)
- *  381  M301 L        lpq_len (int)
+ *  321  M301 E0 PIDC  Kp[0], Ki[0], Kd[0], Kc[0] (float x4)
+ *  337  M301 E1 PIDC  Kp[1], Ki[1], Kd[1], Kc[1] (float x4)
+ *  353  M301 E2 PIDC  Kp[2], Ki[2], Kd[2], Kc[2] (float x4)
+ *  369  M301 E3 PIDC  Kp[3], Ki[3], Kd[3], Kc[3] (float x4)
+ *  385  M301 L        lpq_len (int)
  *
  * PIDTEMPBED:
- *  383  M304 PID  thermalManager.bedKp, thermalManager.bedKi, thermalManager.bedKd (float x3)
+ *  387  M304 PID  thermalManager.bedKp, thermalManager.bedKi, thermalManager.bedKd (float x3)
  *
  * DOGLCD:
- *  395  M250 C    lcd_contrast (int)
+ *  399  M250 C    lcd_contrast (int)
  *
  * FWRETRACT:
- *  397  M209 S    autoretract_enabled (bool)
- *  398  M207 S    retract_length (float)
- *  402  M207 W    retract_length_swap (float)
- *  406  M207 F    retract_feedrate_mm_s (float)
- *  410  M207 Z    retract_zlift (float)
- *  414  M208 S    retract_recover_length (float)
- *  418  M208 W    retract_recover_length_swap (float)
- *  422  M208 F    retract_recover_feedrate_mm_s (float)
+ *  401  M209 S    autoretract_enabled (bool)
+ *  402  M207 S    retract_length (float)
+ *  406  M207 W    retract_length_swap (float)
+ *  410  M207 F    retract_feedrate_mm_s (float)
+ *  414  M207 Z    retract_zlift (float)
+ *  418  M208 S    retract_recover_length (float)
+ *  422  M208 W    retract_recover_length_swap (float)
+ *  426  M208 F    retract_recover_feedrate_mm_s (float)
  *
  * Volumetric Extrusion:
- *  426  M200 D    volumetric_enabled (bool)
- *  427  M200 T D  filament_size (float x4) (T0..3)
+ *  430  M200 D    volumetric_enabled (bool)
+ *  431  M200 T D  filament_size (float x4) (T0..3)
  *
- *  443  This Slot is Available!
+ *  447  This Slot is Available!
  *
  */
 #include "Marlin.h"
@@ -218,6 +219,12 @@ void Config_Postprocess() {
     EEPROM_WRITE(planner.min_travel_feedrate_mm_s);
     EEPROM_WRITE(planner.min_segment_time);
     EEPROM_WRITE(planner.max_jerk);
+    #if ENABLED(JUNCTION_DEVIATION)
+      EEPROM_WRITE(planner.junction_deviation_mm);
+    #else
+      dummy = 0.0f;
+      EEPROM_WRITE(dummy);
+    #endif
     EEPROM_WRITE(home_offset);
 
     #if HOTENDS > 1
@@ -407,6 +414,11 @@ void Config_Postprocess() {
       EEPROM_READ(planner.min_travel_feedrate_mm_s);
       EEPROM_READ(planner.min_segment_time);
       EEPROM_READ(planner.max_jerk);
+      #if ENABLED(JUNCTION_DEVIATION)
+        EEPROM_READ(planner.junction_deviation_mm);
+      #else
+        EEPROM_READ(dummy);
+      #endif
       EEPROM_READ(home_offset);
 
       #if HOTENDS > 1
@@ -587,6 +599,9 @@ void Config_ResetDefault() {
   planner.max_jerk[Y_AXIS] = DEFAULT_YJERK;
   planner.max_jerk[Z_AXIS] = DEFAULT_ZJERK;
   planner.max_jerk[E_AXIS] = DEFAULT_EJERK;
+  #if ENABLED(JUNCTION_DEVIATION)
+    planner.junction_deviation_mm = JUNCTION_DEVIATION_MM;
+  #endif
   home_offset[X_AXIS] = home_offset[Y_AXIS] = home_offset[Z_AXIS] = 0;
 
   #if HOTENDS > 1
@@ -781,7 +796,11 @@ void Config_ResetDefault() {
 
     CONFIG_ECHO_START;
     if (!forReplay) {
-      SERIAL_ECHOLNPGM("Advanced variables: S=Min feedrate (mm/s), T=Min travel feedrate (mm/s), B=minimum segment time (ms), X=maximum XY jerk (mm/s),  Z=maximum Z jerk (mm/s),  E=maximum E jerk (mm/s)");
+      SERIAL_ECHOLNPGM("Advanced variables: S=Min feedrate (mm/s), T=Min travel feedrate (mm/s), B=minimum segment time (ms), X=maximum XY jerk (mm/s),  Z=maximum Z jerk (mm/s),  E=maximum E jerk (mm/s)"
+        #if ENABLED(JUNCTION_DEVIATION)
+          ",  J=junction deviation (mm)"
+        #endif
+      );
       CONFIG_ECHO_START;
     }
     SERIAL_ECHOPAIR("  M205 S", planner.min_feedrate_mm_s);
@@ -791,6 +810,9 @@ void Config_ResetDefault() {
     SERIAL_ECHOPAIR(" Y", planner.max_jerk[Y_AXIS]);
     SERIAL_ECHOPAIR(" Z", planner.max_jerk[Z_AXIS]);
     SERIAL_ECHOPAIR(" E", planner.max_jerk[E_AXIS]);
+    #if ENABLED(JUNCTION_DEVIATION)
+      SERIAL_ECHOPAIR(" J", planner.junction_deviation_mm);
+    #endif
     SERIAL_EOL;
 
     CONFIG_ECHO_START;
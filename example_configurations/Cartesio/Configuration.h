@@ -527,6 +527,35 @@
 #define DEFAULT_ZJERK                  0.4
 #define DEFAULT_EJERK                  5.0
 
+/**
+ * Junction Deviation
+ *
+ * Limit the speed at each junction by centripetal acceleration instead of
+ * by the X, Y and Z jerk values above. The deviation is the distance (mm)
+ * from the corner to the arc that the move is allowed to blend through.
+ * Nearly collinear segments, as found on finely segmented curves, barely
+ * slow down, while sharp corners still do. The E jerk still limits how much
+ * the extrusion rate may change at a junction.
+ *
+ * Override with M205 J
+ */
+//#define JUNCTION_DEVIATION
+#if ENABLED(JUNCTION_DEVIATION)
+  #define JUNCTION_DEVIATION_MM 0.02  // (mm) Distance from the corner to the blended arc
+#endif
+
+/**
+ * S-Curve Acceleration
+ *
+ * Replace the constant-acceleration ramps with jerk-limited S-curves.
+ * The speed follows a smooth curve over the same time and distance as the
+ * trapezoid, so acceleration eases in and out instead of switching on and
+ * off at each ramp. The curve is steepest halfway up, where it reaches
+ * 1.875x the set acceleration, so tune acceleration and ringing with it
+ * enabled. (See test/bezier_curve_test.cpp)
+ */
+//#define S_CURVE_ACCELERATION
+
 
 //===========================================================================
 //============================= Z Probe Options =============================
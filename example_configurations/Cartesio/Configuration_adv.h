@@ -437,6 +437,32 @@
   #define SD_FINISHED_STEPPERRELEASE true  //if sd support and the file is finished: disable steppers?
   #define SD_FINISHED_RELEASECOMMAND "M84 X Y Z E" // You might want to keep the z enabled so your bed stays in place.
 
+  // Read the file being printed a whole 512-byte block at a time into a
+  // read-ahead buffer, instead of a byte at a time through the file system.
+  // Costs 512 bytes of SRAM but keeps SD printing of dense files from
+  // starving the planner.
+  //#define SD_READ_AHEAD
+
+  // Keep a multiple block read (CMD18) open while printing, so consecutive
+  // blocks of the file stream from the card without a new read command for
+  // each one. Any other card access ends the stream. Requires SD_READ_AHEAD.
+  //#define SD_MULTI_BLOCK_READ
+
+  // Gather the lines saved by M28 and M928 into whole blocks and stream them to the
+  // card with one multiple block write (CMD25), pre-erased with ACMD23. Space for
+  // the file is claimed in contiguous runs of SD_WRITE_RESERVE_KB, and the unused
+  // part given back on M29. The transfer rate is reported when the file is closed.
+  // Costs 512 bytes of SRAM, shared with SD_READ_AHEAD.
+  //#define SD_MULTI_BLOCK_WRITE
+  #if ENABLED(SD_MULTI_BLOCK_WRITE)
+    #define SD_WRITE_RESERVE_KB 4096
+  #endif
+
+  // Give FAT blocks a 512-byte cache of their own, so following a file's cluster chain
+  // doesn't evict the file's data block, and listing a directory doesn't re-read the
+  // FAT. Costs 512 bytes of SRAM.
+  //#define SD_FAT_CACHE
+
   #define SDCARD_RATHERRECENTFIRST  //reverse file order of sd card menu display. Its sorted practically after the file system block order.
   // if a file is deleted, it frees a block. hence, the order is not purely chronological. To still have auto0.g accessible, there is again the option to do that.
   // using:
@@ -537,6 +563,56 @@
   #define MIN_BLOCK_TIME 6         // (ms) Minimum duration of a single block. You shouldn't need to modify this.
 #endif
 
+//
+// Planner Profiling
+//
+// Measure how long the planner takes to add each block, to compare planner changes on a
+// running machine. M801 reports the blocks planned per second and the average and peak
+// time spent in _buffer_line() and recalculate(). M801 R resets the counters.
+// M801 D1 echoes each trapezoid once the stepper has run it, for diffing profile changes.
+//
+//#define PLANNER_PROFILING
+
+//
+// Interrupt Profiling
+//
+// Time the stepper and temperature interrupts to see how close they come to their budget
+// before raising MAX_STEP_FREQUENCY or microstepping, or enabling LIN_ADVANCE. M803 reports
+// the minimum, average and maximum durations, how often each number of step loops was used,
+// and overruns where an interrupt ended after the next one was due. M803 R resets the counters.
+//
+//#define ISR_PROFILING
+
+//
+// Command Profiling
+//
+// Count how many times each G and M command runs, to see which commands dominate a print.
+// M804 lists the commands that have run, with their counts. M804 R resets the counters.
+// Uses 4 bytes of RAM for each command compiled into the firmware.
+//
+//#define COMMAND_PROFILING
+
+//
+// SD Transfer Profiling
+//
+// Time the SPI transfer of each 512-byte block to and from the SD card. M806 reports the
+// number of blocks read and written, the minimum, average and maximum time per block, and
+// the average CPU cycles per byte, against the 16 cycles a byte takes at full SPI speed.
+// It also reports the block cache hits and misses. M806 R resets the counters.
+// (Requires SDSUPPORT)
+//
+//#define SD_TRANSFER_PROFILING
+
+//
+// Fixed-Point Trapezoids
+//
+// Compute the acceleration and deceleration step counts of each trapezoid with integer
+// math instead of emulated float divides and ceil/floor. This is done every time a block
+// is replanned, so it shortens the time spent planning each new block. The results stay
+// within one step of the float calculation. Uses 5 bytes more RAM per planner block.
+//
+//#define PLANNER_FIXED_POINT
+
 // @section extruder
 
 // extruder advance constant (s2/mm3)
@@ -604,10 +680,30 @@
 // Moves (or segments) with fewer steps than this will be joined with the next move
 #define MIN_STEPS_PER_SEGMENT 6
 
+// Merge runs of short, nearly collinear G0/G1 moves into a single planner block before
+// they are buffered. This frees block slots and planner time when a slicer sends many tiny
+// segments. A held move is sent as soon as any other command arrives, or when the planner
+// runs low. M802 reports how many segments were merged. (Cartesian machines only)
+//#define SEGMENT_COALESCING
+#if ENABLED(SEGMENT_COALESCING)
+  #define COALESCE_MAX_ANGLE     1.0  // (degrees) Largest direction change that is merged
+  #define COALESCE_MAX_E_CHANGE  0.02 // Largest relative change in extrusion per mm that is merged
+  #define COALESCE_MAX_SEGMENTS  8    // Most segments merged into one move
+#endif
+
 // The minimum pulse width (in µs) for stepping a stepper.
 // Set this if you find stepping unreliable, or if using a very fast CPU.
 #define MINIMUM_STEPPER_PULSE 0 // (µs) The smallest stepper pulse allowed
 
+// Adaptive Multi-Axis Step Smoothing (AMASS). At low step rates the stepper interrupt runs
+// 2, 4 or 8 times per step event, keeping it near 10kHz. The Bresenham counters are scaled
+// to match, so the steps of the slower axes in a diagonal move are spaced more evenly.
+// This reduces vibration on slow moves. Not compatible with ADVANCE or MIXING_EXTRUDER.
+//#define ADAPTIVE_STEP_SMOOTHING
+#if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+  #define AMASS_MAX_LEVEL 3 // Oversample slow moves by up to 2^AMASS_MAX_LEVEL (1-3)
+#endif
+
 // @section temperature
 
 // Control heater 0 and heater 1 in parallel.
@@ -627,12 +723,45 @@
   #define BLOCK_BUFFER_SIZE 16 // maximize block buffer
 #endif
 
+// Prepare the stepper timing in the main loop as short constant-rate segments, so the
+// stepper ISR only loads the next segment and emits steps instead of stepping through the
+// trapezoid itself. When the main loop is held up the temperature ISR tops the buffer up,
+// and any time the stepper still runs dry mid-move is reported as an error.
+// Not compatible with ADVANCE, LIN_ADVANCE or S_CURVE_ACCELERATION.
+//#define STEP_SEGMENT_BUFFER
+#if ENABLED(STEP_SEGMENT_BUFFER)
+  #define STEP_SEGMENT_BUFFER_SIZE 16  // Segments prepared ahead of the stepper. Must be a power of 2.
+  #define STEP_SEGMENTS_PER_SECOND 100 // Acceleration is applied in steps this many times per second
+#endif
+
 // @section serial
 
 // The ASCII buffer for serial input
 #define MAX_CMD_SIZE 96
 #define BUFSIZE 4
 
+// Parse each command as it is queued and store only its code and numeric parameters,
+// instead of the whole line of text. A G1 takes 12 + 4 * PARSED_COMMAND_VALUES bytes
+// instead of MAX_CMD_SIZE. Commands with text arguments (M0, M1, M23, M28, M30, M32,
+// M33, M117, M928) or too many values are kept as text, in PARSED_COMMAND_TEXT_SLOTS
+// lines of MAX_CMD_SIZE, so the queue holds about 2x as many commands in the same RAM.
+// Lines saved by M28 are all text, so while saving only the text slots are used.
+// Not compatible with ADVANCED_OK.
+//#define PARSED_COMMAND_QUEUE
+#if ENABLED(PARSED_COMMAND_QUEUE)
+  #define PARSED_COMMAND_VALUES 6     // Numeric parameters stored per command (e.g., G2 X Y I J E F)
+  #define PARSED_COMMAND_TEXT_SLOTS 2 // Commands kept as text that can be queued at once
+#endif
+
+// Pack queued commands end to end in a ring of COMMAND_QUEUE_BYTES bytes instead of
+// reserving MAX_CMD_SIZE bytes for each of BUFSIZE commands. The queue then holds as
+// many commands as fit, so a stream of short G1 lines is buffered 3-4x deeper in the
+// same RAM. Not compatible with PARSED_COMMAND_QUEUE.
+//#define PACKED_COMMAND_QUEUE
+#if ENABLED(PACKED_COMMAND_QUEUE)
+  #define COMMAND_QUEUE_BYTES (BUFSIZE * (MAX_CMD_SIZE)) // The same RAM as the fixed queue
+#endif
+
 // Transfer Buffer Size
 // To save 386 bytes of PROGMEM (and TX_BUFFER_SIZE+3 bytes of RAM) set to 0.
 // To buffer a simple "ok" you need 4 bytes.
@@ -648,6 +777,39 @@
 // Does not work on boards using AT90USB (USBCON) processors!
 //#define EMERGENCY_PARSER
 
+// Drop comments, blank lines and extra leading spaces in the serial receive interrupt,
+// before they take up space in the receive buffer. G-code from slicers is full of
+// comments, so more real commands fit in the buffer. Lines are otherwise unchanged,
+// and a line of spaces before a comment still reaches the main loop to be answered.
+// Not compatible with BINARY_MOVE_PROTOCOL.
+// Does not work on boards using AT90USB (USBCON) processors!
+//#define RX_COMMENT_STRIPPING
+
+// Frame serial lines in the receive interrupt, right in the next free command queue
+// slot, instead of copying each character through the receive buffer and a line buffer.
+// get_serial_commands() only checks the line number and checksum and commits the line.
+// The receive buffer is still used while the queue is full.
+// Not compatible with PARSED_COMMAND_QUEUE, PACKED_COMMAND_QUEUE or BINARY_MOVE_PROTOCOL.
+// Does not work on boards using AT90USB (USBCON) processors!
+//#define RX_LINE_FRAMING
+
+// Act on single-character commands in the serial receive interrupt, ahead of the
+// command queue. They are never stored in a line, so they can be sent at any time:
+//   REALTIME_STATUS     Report the state, stepper positions, planner and queue fill
+//                       and temperatures as "<Run X:... Y:... Z:... E:... P:n Q:n T:...>"
+//                       once the line being printed is finished
+//   REALTIME_FEED_HOLD  Slow down to a stop at the current acceleration
+//   REALTIME_RESUME     Speed back up after a feed hold
+// Avoid XON/XOFF (0x11/0x13), which serial drivers may use for flow control.
+// Requires STEP_SEGMENT_BUFFER. Not compatible with BINARY_MOVE_PROTOCOL.
+// Does not work on boards using AT90USB (USBCON) processors!
+//#define REALTIME_COMMANDS
+#if ENABLED(REALTIME_COMMANDS)
+  #define REALTIME_STATUS    0x05 // ASCII ENQ
+  #define REALTIME_FEED_HOLD 0xF8 // 0xF5-0xFD never occur in UTF-8 text, so they are never
+  #define REALTIME_RESUME    0xF9 // part of a G-code line, an M117 message or an M28 upload
+#endif
+
 // Bad Serial-connections can miss a received command by sending an 'ok'
 // Therefore some clients abort after 30 seconds in a timeout.
 // Some other clients start sending commands while receiving a 'wait'.
@@ -657,6 +819,22 @@
 // Some clients will have this feature soon. This could make the NO_TIMEOUTS unnecessary.
 //#define ADVANCED_OK
 
+// Let hosts stream with byte credits, as with grbl's character-counting protocol.
+// M115 reports the receive buffer size, and every "ok" ends with C<bytes>, the number
+// of characters read from the buffer since the last "ok". A host that keeps no more than
+// that many unacknowledged characters in flight can fill the buffer without overrunning
+// it. Lost characters are counted and reported as errors.
+// Does not work on boards using AT90USB (USBCON) processors!
+//#define SERIAL_BYTE_CREDITS
+
+// Accept binary move frames between G-code lines after "M805". A frame takes 6-12 bytes
+// instead of a 30-40 character G1 line, so several times more moves per second fit through
+// the same serial link. The frame layout is described in Marlin_main.cpp.
+//#define BINARY_MOVE_PROTOCOL
+#if ENABLED(BINARY_MOVE_PROTOCOL)
+  #define BINARY_MOVE_UNITS 1000 // Frame position units per mm (1000 = 0.001mm)
+#endif
+
 // @section fwretract
 
 // Firmware based and LCD controlled retract
@@ -0,0 +1,88 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (C) 2016 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * Based on Sprinter and grbl.
+ * Copyright (C) 2011 Camiel Gubbels / Erik van der Zalm
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * Number parsing for G-code parameters. G-code numbers are only a sign,
+ * digits and a fraction, so these skip the locale, exponent and overflow
+ * handling of strtod() and strtol(). A following letter, including 'E',
+ * simply ends the number.
+ *
+ * Nothing here depends on the hardware, so test/gcode_number_test.cpp
+ * can check it against strtod() on the host.
+ */
+
+#ifndef __GCODE_NUMBER_H__
+#define __GCODE_NUMBER_H__
+
+#include <stdint.h>
+#include "macros.h"
+
+// Skip leading spaces and tabs and a sign. Return true for a minus sign.
+inline bool parse_sign(const char* &p) {
+  while (*p == ' ' || *p == '\t') p++;
+  if (*p == '-') { p++; return true; }
+  if (*p == '+') p++;
+  return false;
+}
+
+inline long parse_long(const char* p) {
+  const bool negative = parse_sign(p);
+  uint32_t n = 0;
+  while (NUMERIC(*p)) n = n * 10 + (*p++ - '0');
+  return negative ? -(long)n : (long)n;
+}
+
+// For values above LONG_MAX. A minus sign negates it, as with strtoul().
+inline unsigned long parse_ulong(const char* p) {
+  const bool negative = parse_sign(p);
+  uint32_t n = 0;
+  while (NUMERIC(*p)) n = n * 10 + (*p++ - '0');
+  return negative ? (uint32_t)-n : n;
+}
+
+// Gather up to 9 digits as an integer, then scale it once. Further
+// digits only scale the integer part; in the fraction they are ignored,
+// which also keeps the divisor within 32 bits.
+// Leave the pointer after the number.
+inline float parse_float(const char* &p) {
+  const bool negative = parse_sign(p);
+  uint32_t n = 0;
+  int8_t exponent = 0;
+  for (; NUMERIC(*p); p++) {
+    if (n < 100000000UL) n = n * 10 + (*p - '0');
+    else if (exponent < 38) exponent++;
+  }
+  if (*p == '.')
+    for (p++; NUMERIC(*p); p++)
+      if (n < 100000000UL && exponent > -9) { n = n * 10 + (*p - '0'); exponent--; }
+  float f = n;
+  if (exponent < 0) {
+    uint32_t d = 10;
+    while (++exponent) d *= 10;
+    f /= d;
+  }
+  else
+    while (exponent--) f *= 10;
+  return negative ? -f : f;
+}
+
+#endif // __GCODE_NUMBER_H__
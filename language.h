@@ -124,6 +124,10 @@
 #define MSG_ERR_CHECKSUM_MISMATCH           "checksum mismatch, Last Line: "
 #define MSG_ERR_NO_CHECKSUM                 "No Checksum with line number, Last Line: "
 #define MSG_ERR_NO_LINENUMBER_WITH_CHECKSUM "No Line Number with checksum, Last Line: "
+#define MSG_ERR_RX_DROPPED                  "Serial characters lost: "
+#define MSG_ERR_SEGMENT_UNDERRUN            "Step segment underruns: "
+#define MSG_ERR_BINARY_FRAME                "Bad binary frame"
+#define MSG_BINARY_RESEND                   "Resend binary: "
 #define MSG_FILE_PRINTED                    "Done printing file"
 #define MSG_BEGIN_FILE_LIST                 "Begin file list"
 #define MSG_END_FILE_LIST                   "End file list"
@@ -228,6 +228,9 @@
 #ifndef MSG_VE_JERK
   #define MSG_VE_JERK                         "Ve-jerk"
 #endif
+#ifndef MSG_JUNCTION_DEVIATION
+  #define MSG_JUNCTION_DEVIATION              "Junction Dev"
+#endif
 #ifndef MSG_VMAX
   #define MSG_VMAX                            "Vmax "
 #endif
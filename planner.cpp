@@ -80,6 +80,7 @@ Planner planner;
 block_t Planner::block_buffer[BLOCK_BUFFER_SIZE];
 volatile uint8_t Planner::block_buffer_head = 0,           // Index of the next block to be pushed
                  Planner::block_buffer_tail = 0;
+uint8_t Planner::block_buffer_planned = 0;                 // Index of the newest block whose entry speed is final
 
 float Planner::max_feedrate_mm_s[XYZE_N], // Max speeds in mm per second
       Planner::axis_steps_per_mm[XYZE_N],
@@ -100,6 +101,10 @@ float Planner::min_feedrate_mm_s,
       Planner::max_jerk[XYZE],       // The largest speed change requiring no acceleration
       Planner::min_travel_feedrate_mm_s;
 
+#if ENABLED(JUNCTION_DEVIATION)
+  float Planner::junction_deviation_mm = JUNCTION_DEVIATION_MM;
+#endif
+
 #if HAS_ABL
   bool Planner::abl_enabled = false; // Flag that auto bed leveling is enabled
 #endif
@@ -129,6 +134,10 @@ uint32_t Planner::cutoff_long;
 float Planner::previous_speed[NUM_AXIS],
       Planner::previous_nominal_speed;
 
+#if ENABLED(JUNCTION_DEVIATION)
+  float Planner::previous_unit_vec[NUM_AXIS];
+#endif
+
 #if ENABLED(DISABLE_INACTIVE_EXTRUDER)
   uint8_t Planner::g_uc_extruder_last_move[EXTRUDERS] = { 0 };
 #endif // DISABLE_INACTIVE_EXTRUDER
@@ -149,6 +158,17 @@ float Planner::previous_speed[NUM_AXIS],
   uint32_t Planner::block_buffer_runtime_us = 0;
 #endif
 
+#if ENABLED(PLANNER_PROFILING)
+  bool Planner::profile_dump_trapezoids = false;
+  uint8_t Planner::profile_dump_index = 0;
+  uint32_t Planner::profile_blocks = 0,
+           Planner::profile_buffer_line_us = 0,
+           Planner::profile_buffer_line_max_us = 0,
+           Planner::profile_recalculate_us = 0,
+           Planner::profile_recalculate_max_us = 0;
+  millis_t Planner::profile_start_ms = 0;
+#endif
+
 /**
  * Class and Instance Methods
  */
@@ -156,7 +176,7 @@ float Planner::previous_speed[NUM_AXIS],
 Planner::Planner() { init(); }
 
 void Planner::init() {
-  block_buffer_head = block_buffer_tail = 0;
+  block_buffer_head = block_buffer_tail = block_buffer_planned = 0;
   ZERO(position);
   #if ENABLED(LIN_ADVANCE)
     ZERO(position_float);
@@ -170,6 +190,37 @@ void Planner::init() {
 
 #define MINIMAL_STEP_RATE 120
 
+// block_t keeps step rates in 16 bits, the same as the stepper ISR
+static_assert(MAX_STEP_FREQUENCY <= 65535, "MAX_STEP_FREQUENCY is too high for the 16-bit step rates in block_t.");
+
+#ifdef __AVR__
+  // The planner buffer is the largest user of SRAM. On AVR, where structs are
+  // packed, block_t is held to the bytes each enabled feature adds to it.
+  constexpr uint16_t block_t_budget = 39 + 4 * (NUM_AXIS) + (FAN_COUNT)
+    #if ENABLED(MIXING_EXTRUDER)
+      + 4 * (MIXING_STEPPERS)
+    #endif
+    #if ENABLED(LIN_ADVANCE)
+      + 5
+    #elif ENABLED(ADVANCE)
+      + 16
+    #endif
+    #if ENABLED(PLANNER_FIXED_POINT)
+      + 5
+    #endif
+    #if ENABLED(S_CURVE_ACCELERATION)
+      + 18
+    #endif
+    #if ENABLED(BARICUDA)
+      + 2
+    #endif
+    #if ENABLED(ENSURE_SMOOTH_MOVES)
+      + 4
+    #endif
+  ;
+  static_assert(sizeof(block_t) <= block_t_budget, "block_t has grown. Update block_t_budget in planner.cpp if that was intended.");
+#endif
+
 /**
  * Calculate trapezoid parameters, multiplying the entry- and exit-speeds
  * by the provided factors.
@@ -182,21 +233,52 @@ void Planner::calculate_trapezoid_for_block(block_t* const block, const float &e
   NOLESS(initial_rate, MINIMAL_STEP_RATE);
   NOLESS(final_rate, MINIMAL_STEP_RATE);
 
-  int32_t accel = block->acceleration_steps_per_s2,
-          accelerate_steps = ceil(estimate_acceleration_distance(initial_rate, block->nominal_rate, accel)),
-          decelerate_steps = floor(estimate_acceleration_distance(block->nominal_rate, final_rate, -accel)),
-          plateau_steps = block->step_event_count - accelerate_steps - decelerate_steps;
+  #if DISABLED(PLANNER_FIXED_POINT) || ENABLED(S_CURVE_ACCELERATION)
+    // Acceleration in steps/s², taken from the rate the stepper ISR actually uses
+    const float accel = block->acceleration_rate * ((F_CPU) * 0.125 / 16777216.0);
+  #endif
+
+  #if ENABLED(PLANNER_FIXED_POINT)
+    int32_t accelerate_steps = acceleration_steps_fixed(block, initial_rate, block->nominal_rate, true),
+            decelerate_steps = acceleration_steps_fixed(block, final_rate, block->nominal_rate, false);
+  #else
+    int32_t accelerate_steps = ceil(estimate_acceleration_distance(initial_rate, block->nominal_rate, accel)),
+            decelerate_steps = floor(estimate_acceleration_distance(block->nominal_rate, final_rate, -accel));
+  #endif
+  int32_t plateau_steps = block->step_event_count - accelerate_steps - decelerate_steps;
 
   // Is the Plateau of Nominal Rate smaller than nothing? That means no cruising, and we will
   // have to use intersection_distance() to calculate when to abort accel and start braking
   // in order to reach the final_rate exactly at the end of this block.
+  #if ENABLED(S_CURVE_ACCELERATION)
+    uint32_t cruise_rate = block->nominal_rate;
+  #endif
   if (plateau_steps < 0) {
-    accelerate_steps = ceil(intersection_distance(initial_rate, final_rate, accel, block->step_event_count));
+    #if ENABLED(PLANNER_FIXED_POINT)
+      accelerate_steps = intersection_steps_fixed(block, initial_rate, final_rate);
+    #else
+      accelerate_steps = ceil(intersection_distance(initial_rate, final_rate, accel, block->step_event_count));
+    #endif
     NOLESS(accelerate_steps, 0); // Check limits due to numerical round-off
     accelerate_steps = min((uint32_t)accelerate_steps, block->step_event_count);//(We can cast here to unsigned, because the above line ensures that we are above zero)
     plateau_steps = 0;
+
+    #if ENABLED(S_CURVE_ACCELERATION)
+      // No cruising, so the peak is the rate reached at the end of acceleration
+      cruise_rate = sqrt(sq((float)initial_rate) + 2.0 * accel * accelerate_steps);
+    #endif
   }
 
+  #if ENABLED(S_CURVE_ACCELERATION)
+    // The S-curve covers the same distance as the linear ramp in the same time,
+    // so the phases are converted from steps to stepper timer ticks (F_CPU / 8).
+    const float ticks_per_rate = block->acceleration_rate ? 16777216.0 / block->acceleration_rate : 0;
+    const uint32_t acceleration_time = bezier_ramp_time(initial_rate, cruise_rate, ticks_per_rate),
+                   deceleration_time = bezier_ramp_time(final_rate, cruise_rate, ticks_per_rate),
+                   acceleration_time_inverse = bezier_time_inverse(acceleration_time),
+                   deceleration_time_inverse = bezier_time_inverse(deceleration_time);
+  #endif
+
   // block->accelerate_until = accelerate_steps;
   // block->decelerate_after = accelerate_steps+plateau_steps;
 
@@ -206,6 +288,13 @@ void Planner::calculate_trapezoid_for_block(block_t* const block, const float &e
     block->decelerate_after = accelerate_steps + plateau_steps;
     block->initial_rate = initial_rate;
     block->final_rate = final_rate;
+    #if ENABLED(S_CURVE_ACCELERATION)
+      block->cruise_rate = cruise_rate;
+      block->acceleration_time = acceleration_time;
+      block->deceleration_time = deceleration_time;
+      block->acceleration_time_inverse = acceleration_time_inverse;
+      block->deceleration_time_inverse = deceleration_time_inverse;
+    #endif
     #if ENABLED(ADVANCE)
       block->initial_advance = block->advance * sq(entry_factor);
       block->final_advance = block->advance * sq(exit_factor);
@@ -229,13 +318,13 @@ void Planner::reverse_pass_kernel(block_t* const current, const block_t *next) {
   // If entry speed is already at the maximum entry speed, no need to recheck. Block is cruising.
   // If not, block in state of acceleration or deceleration. Reset entry speed to maximum and
   // check for maximum allowable speed reductions to ensure maximum possible planned speed.
-  float max_entry_speed = current->max_entry_speed;
-  if (current->entry_speed != max_entry_speed) {
+  float max_entry = Planner::max_entry_speed(current);
+  if (current->entry_speed != max_entry) {
     // If nominal length true, max junction speed is guaranteed to be reached. Only compute
     // for max allowable speed if block is decelerating and nominal length is false.
-    current->entry_speed = (TEST(current->flag, BLOCK_BIT_NOMINAL_LENGTH) || max_entry_speed <= next->entry_speed)
-      ? max_entry_speed
-      : min(max_entry_speed, max_allowable_speed(-current->acceleration, next->entry_speed, current->millimeters));
+    current->entry_speed = (TEST(current->flag, BLOCK_BIT_NOMINAL_LENGTH) || max_entry <= next->entry_speed)
+      ? max_entry
+      : min(max_entry, max_allowable_speed(current->accel_mm_x2, next->entry_speed));
     SBI(current->flag, BLOCK_BIT_RECALCULATE);
   }
 }
@@ -243,28 +332,20 @@ void Planner::reverse_pass_kernel(block_t* const current, const block_t *next) {
 /**
  * recalculate() needs to go over the current plan twice.
  * Once in reverse and once forward. This implements the reverse pass.
+ *
+ * Only blocks newer than block_buffer_planned are visited. The entry speed
+ * of the newest block was set by _buffer_line, so the walk starts with the
+ * one before it.
  */
 void Planner::reverse_pass() {
-
-  if (movesplanned() > 3) {
-
-    block_t* block[3] = { NULL, NULL, NULL };
-
-    // Make a local copy of block_buffer_tail, because the interrupt can alter it
-    // Is a critical section REALLY needed for a single byte change?
-    //CRITICAL_SECTION_START;
-    uint8_t tail = block_buffer_tail;
-    //CRITICAL_SECTION_END
-
-    uint8_t b = BLOCK_MOD(block_buffer_head - 3);
-    while (b != tail) {
-      if (block[0] && TEST(block[0]->flag, BLOCK_BIT_START_FROM_FULL_HALT)) break;
-      b = prev_block_index(b);
-      block[2] = block[1];
-      block[1] = block[0];
-      block[0] = &block_buffer[b];
-      reverse_pass_kernel(block[1], block[2]);
-    }
+  uint8_t b = prev_block_index(block_buffer_head);
+  if (b == block_buffer_planned) return;
+
+  block_t *next = &block_buffer[b];
+  for (b = prev_block_index(b); b != block_buffer_planned; b = prev_block_index(b)) {
+    block_t* const current = &block_buffer[b];
+    reverse_pass_kernel(current, next);
+    next = current;
   }
 }
 
@@ -279,7 +360,7 @@ void Planner::forward_pass_kernel(const block_t* previous, block_t* const curren
   if (!TEST(previous->flag, BLOCK_BIT_NOMINAL_LENGTH)) {
     if (previous->entry_speed < current->entry_speed) {
       float entry_speed = min(current->entry_speed,
-                               max_allowable_speed(-previous->acceleration, previous->entry_speed, previous->millimeters));
+                               max_allowable_speed(previous->accel_mm_x2, previous->entry_speed));
       // Check for junction speed change
       if (current->entry_speed != entry_speed) {
         current->entry_speed = entry_speed;
@@ -292,26 +373,34 @@ void Planner::forward_pass_kernel(const block_t* previous, block_t* const curren
 /**
  * recalculate() needs to go over the current plan twice.
  * Once in reverse and once forward. This implements the forward pass.
+ *
+ * A block's entry speed becomes final once it reaches the junction maximum
+ * or is limited by acceleration out of the previous block. New blocks can
+ * only raise the reverse-pass limits, so nothing up to that block can change
+ * again and block_buffer_planned is advanced to it.
  */
 void Planner::forward_pass() {
-  block_t* block[3] = { NULL, NULL, NULL };
-
-  for (uint8_t b = block_buffer_tail; b != block_buffer_head; b = next_block_index(b)) {
-    block[0] = block[1];
-    block[1] = block[2];
-    block[2] = &block_buffer[b];
-    forward_pass_kernel(block[0], block[1]);
+  const block_t *previous = NULL;
+
+  for (uint8_t b = block_buffer_planned; b != block_buffer_head; b = next_block_index(b)) {
+    block_t* const current = &block_buffer[b];
+    if (previous) {
+      const float entry_speed = current->entry_speed;
+      forward_pass_kernel(previous, current);
+      if (current->entry_speed != entry_speed || current->entry_speed == max_entry_speed(current))
+        block_buffer_planned = b;
+    }
+    previous = current;
   }
-  forward_pass_kernel(block[1], block[2]);
 }
 
 /**
- * Recalculate the trapezoid speed profiles for all blocks in the plan
+ * Recalculate the trapezoid speed profiles for the blocks starting at 'first'
  * according to the entry_factor for each junction. Must be called by
  * recalculate() after updating the blocks.
  */
-void Planner::recalculate_trapezoids() {
-  int8_t block_index = block_buffer_tail;
+void Planner::recalculate_trapezoids(const uint8_t first) {
+  uint8_t block_index = first;
   block_t *current, *next = NULL;
 
   while (block_index != block_buffer_head) {
@@ -359,13 +448,87 @@ void Planner::recalculate_trapezoids() {
  * jerk is jerkier than the set limit, Jerky. Finally it will:
  *
  *   3. Recalculate "trapezoids" for all blocks.
+ *
+ * Blocks up to block_buffer_planned are already optimal and are skipped, so
+ * the cost of adding a block is amortized over the plan instead of growing
+ * with BLOCK_BUFFER_SIZE.
  */
 void Planner::recalculate() {
+  #if ENABLED(PLANNER_PROFILING)
+    const uint32_t start_us = micros();
+  #endif
+
+  // If the stepper has consumed the planned block, restart from the tail.
+  // The tail is read once since the interrupt can advance it.
+  const uint8_t tail = block_buffer_tail;
+  if (BLOCK_MOD(block_buffer_planned - tail) >= BLOCK_MOD(block_buffer_head - tail))
+    block_buffer_planned = tail;
+
+  // The block before the planned one already has its final trapezoid
+  const uint8_t first = block_buffer_planned;
+
   reverse_pass();
   forward_pass();
-  recalculate_trapezoids();
+  recalculate_trapezoids(first);
+
+  #if ENABLED(PLANNER_PROFILING)
+    const uint32_t us = micros() - start_us;
+    profile_recalculate_us += us;
+    NOLESS(profile_recalculate_max_us, us);
+  #endif
 }
 
+#if ENABLED(PLANNER_PROFILING)
+
+  void Planner::profile_reset() {
+    profile_blocks = profile_buffer_line_us = profile_buffer_line_max_us = 0;
+    profile_recalculate_us = profile_recalculate_max_us = 0;
+    profile_start_ms = millis();
+  }
+
+  /**
+   * Report the planner timing since the last reset.
+   * All times are in microseconds and exclude waiting for a free block.
+   */
+  void Planner::profile_report() {
+    const millis_t ms = millis() - profile_start_ms;
+    const uint32_t n = profile_blocks ? profile_blocks : 1;
+    SERIAL_ECHO_START;
+    SERIAL_ECHOPAIR("Planner blocks:", (unsigned long)profile_blocks);
+    SERIAL_ECHOPAIR(" per s:", ms ? profile_blocks * 1000.0 / ms : 0.0);
+    SERIAL_ECHOPAIR(" buffer_line avg:", (unsigned long)(profile_buffer_line_us / n));
+    SERIAL_ECHOPAIR(" max:", (unsigned long)profile_buffer_line_max_us);
+    SERIAL_ECHOPAIR(" recalculate avg:", (unsigned long)(profile_recalculate_us / n));
+    SERIAL_ECHOLNPAIR(" max:", (unsigned long)profile_recalculate_max_us);
+    SERIAL_ECHO_START;
+    SERIAL_ECHOPAIR("Block bytes:", (int)sizeof(block_t));
+    SERIAL_ECHOLNPAIR(" buffer bytes:", (int)sizeof(block_t) * BLOCK_BUFFER_SIZE);
+  }
+
+  /**
+   * Echo the trapezoids of the blocks the stepper has finished since the
+   * last call, so each block is printed exactly once, as it was run.
+   * Called from idle(), and by _buffer_line() before it reuses a block.
+   */
+  void Planner::profile_dump() {
+    const uint8_t tail = block_buffer_tail;
+    if (!profile_dump_trapezoids) {
+      profile_dump_index = tail;
+      return;
+    }
+    for (; profile_dump_index != tail; profile_dump_index = next_block_index(profile_dump_index)) {
+      const block_t* const block = &block_buffer[profile_dump_index];
+      SERIAL_ECHOPAIR("TRAP n", (unsigned long)block->step_event_count);
+      SERIAL_ECHOPAIR(" i", (unsigned long)block->initial_rate);
+      SERIAL_ECHOPAIR(" c", (unsigned long)block->nominal_rate);
+      SERIAL_ECHOPAIR(" f", (unsigned long)block->final_rate);
+      SERIAL_ECHOPAIR(" a", (long)block->accelerate_until);
+      SERIAL_ECHOLNPAIR(" d", (long)block->decelerate_after);
+    }
+  }
+
+#endif // PLANNER_PROFILING
+
 
 #if ENABLED(AUTOTEMP)
 
@@ -651,6 +814,14 @@ void Planner::check_axes_activity() {
  */
 void Planner::_buffer_line(const float &a, const float &b, const float &c, const float &e, float fr_mm_s, const uint8_t extruder) {
 
+  #if ENABLED(SEGMENT_COALESCING)
+    flush_coalesced_move(); // A held G0/G1 comes first
+  #endif
+
+  #if ENABLED(PLANNER_PROFILING)
+    uint32_t profile_start_us = micros();
+  #endif
+
   // The target position of the tool in absolute steps
   // Calculate target position in absolute steps
   //this should be done after the wait, because otherwise a M92 code within the gcode disrupts this calculation somehow
@@ -763,8 +934,17 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
 
   // If the buffer is full: good! That means we are well ahead of the robot.
   // Rest here until there is room in the buffer.
+  #if ENABLED(PLANNER_PROFILING)
+    const uint32_t wait_start_us = micros();
+  #endif
+
   while (block_buffer_tail == next_buffer_head) idle();
 
+  #if ENABLED(PLANNER_PROFILING)
+    profile_dump(); // Before the block is reused
+    profile_start_us += micros() - wait_start_us; // Don't count the wait or the echo
+  #endif
+
   // Prepare to set up new block
   block_t* block = &block_buffer[block_buffer_head];
 
@@ -959,11 +1139,12 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
   #endif
   delta_mm[E_AXIS] = esteps_float * steps_to_mm[E_AXIS_N];
 
+  float millimeters;
   if (block->steps[X_AXIS] < MIN_STEPS_PER_SEGMENT && block->steps[Y_AXIS] < MIN_STEPS_PER_SEGMENT && block->steps[Z_AXIS] < MIN_STEPS_PER_SEGMENT) {
-    block->millimeters = fabs(delta_mm[E_AXIS]);
+    millimeters = fabs(delta_mm[E_AXIS]);
   }
   else {
-    block->millimeters = sqrt(
+    millimeters = sqrt(
       #if CORE_IS_XY
         sq(delta_mm[X_HEAD]) + sq(delta_mm[Y_HEAD]) + sq(delta_mm[Z_AXIS])
       #elif CORE_IS_XZ
@@ -975,7 +1156,7 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
       #endif
     );
   }
-  float inverse_millimeters = 1.0 / block->millimeters;  // Inverse millimeters to remove multiple divides
+  float inverse_millimeters = 1.0 / millimeters;  // Inverse millimeters to remove multiple divides
 
   // Calculate moves/second for this move. No divide by zero due to previous checks.
   float inverse_mm_s = fr_mm_s * inverse_millimeters;
@@ -1010,8 +1191,8 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
     block_buffer_runtime_us += segment_time;
   #endif
 
-  block->nominal_speed = block->millimeters * inverse_mm_s; // (mm/sec) Always > 0
-  block->nominal_rate = ceil(block->step_event_count * inverse_mm_s); // (step/sec) Always > 0
+  block->nominal_speed = millimeters * inverse_mm_s; // (mm/sec) Always > 0
+  block->nominal_rate = min(ceil(block->step_event_count * inverse_mm_s), 65535.0); // (step/sec) Always > 0. Above MAX_STEP_FREQUENCY anyway.
 
   #if ENABLED(FILAMENT_WIDTH_SENSOR)
     static float filwidth_e_count = 0, filwidth_delay_dist = 0;
@@ -1138,62 +1319,19 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
       LIMIT_ACCEL_FLOAT(E_AXIS,extruder);
     }
   }
-  block->acceleration_steps_per_s2 = accel;
-  block->acceleration = accel / steps_per_mm;
+  #if ENABLED(PLANNER_FIXED_POINT)
+    // Normalize 1 / 2a so the trapezoid math keeps 32 significant bits
+    static_assert(sizeof(accel) <= 4, "acceleration_steps_shift() needs a 32-bit accel to keep the shift in range.");
+    block->acceleration_steps_shift = acceleration_steps_shift(accel);
+    block->acceleration_steps_inverse = acceleration_steps_inverse(accel, block->acceleration_steps_shift);
+  #endif
+  const float acceleration = accel / steps_per_mm; // (mm/sec^2)
+  block->accel_mm_x2 = 2.0 * acceleration * millimeters;
   block->acceleration_rate = (long)(accel * 16777216.0 / ((F_CPU) * 0.125)); // * 8.388608
 
   // Initial limit on the segment entry velocity
   float vmax_junction;
 
-  #if 0  // Use old jerk for now
-
-    float junction_deviation = 0.1;
-
-    // Compute path unit vector
-    double unit_vec[XYZ] = {
-      delta_mm[X_AXIS] * inverse_millimeters,
-      delta_mm[Y_AXIS] * inverse_millimeters,
-      delta_mm[Z_AXIS] * inverse_millimeters
-    };
-
-    /*
-       Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
-
-       Let a circle be tangent to both previous and current path line segments, where the junction
-       deviation is defined as the distance from the junction to the closest edge of the circle,
-       collinear with the circle center.
-
-       The circular segment joining the two paths represents the path of centripetal acceleration.
-       Solve for max velocity based on max acceleration about the radius of the circle, defined
-       indirectly by junction deviation.
-
-       This may be also viewed as path width or max_jerk in the previous grbl version. This approach
-       does not actually deviate from path, but used as a robust way to compute cornering speeds, as
-       it takes into account the nonlinearities of both the junction angle and junction velocity.
-     */
-
-    vmax_junction = MINIMUM_PLANNER_SPEED; // Set default max junction speed
-
-    // Skip first block or when previous_nominal_speed is used as a flag for homing and offset cycles.
-    if (block_buffer_head != block_buffer_tail && previous_nominal_speed > 0.0) {
-      // Compute cosine of angle between previous and current path. (prev_unit_vec is negative)
-      // NOTE: Max junction velocity is computed without sin() or acos() by trig half angle identity.
-      float cos_theta = - previous_unit_vec[X_AXIS] * unit_vec[X_AXIS]
-                        - previous_unit_vec[Y_AXIS] * unit_vec[Y_AXIS]
-                        - previous_unit_vec[Z_AXIS] * unit_vec[Z_AXIS] ;
-      // Skip and use default max junction speed for 0 degree acute junction.
-      if (cos_theta < 0.95) {
-        vmax_junction = min(previous_nominal_speed, block->nominal_speed);
-        // Skip and avoid divide by zero for straight junctions at 180 degrees. Limit to min() of nominal speeds.
-        if (cos_theta > -0.95) {
-          // Compute maximum junction velocity based on maximum acceleration and junction deviation
-          float sin_theta_d2 = sqrt(0.5 * (1.0 - cos_theta)); // Trig half angle identity. Always positive.
-          NOMORE(vmax_junction, sqrt(block->acceleration * junction_deviation * sin_theta_d2 / (1.0 - sin_theta_d2)));
-        }
-      }
-    }
-  #endif
-
   /**
    * Adapted from Prusa MKS firmware
    *
@@ -1224,6 +1362,86 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
     }
   }
 
+  #if ENABLED(JUNCTION_DEVIATION)
+
+    // Compute path unit vector. Moves without XYZ motion get a zero vector.
+    // E holds the extruder distance per mm of path.
+    float unit_vec[NUM_AXIS] = { 0.0 };
+    const bool has_xyz = block->steps[X_AXIS] >= MIN_STEPS_PER_SEGMENT || block->steps[Y_AXIS] >= MIN_STEPS_PER_SEGMENT || block->steps[Z_AXIS] >= MIN_STEPS_PER_SEGMENT;
+    if (has_xyz) {
+      #if CORE_IS_XY
+        unit_vec[X_AXIS] = delta_mm[X_HEAD] * inverse_millimeters;
+        unit_vec[Y_AXIS] = delta_mm[Y_HEAD] * inverse_millimeters;
+        unit_vec[Z_AXIS] = delta_mm[Z_AXIS] * inverse_millimeters;
+      #elif CORE_IS_XZ
+        unit_vec[X_AXIS] = delta_mm[X_HEAD] * inverse_millimeters;
+        unit_vec[Y_AXIS] = delta_mm[Y_AXIS] * inverse_millimeters;
+        unit_vec[Z_AXIS] = delta_mm[Z_HEAD] * inverse_millimeters;
+      #elif CORE_IS_YZ
+        unit_vec[X_AXIS] = delta_mm[X_AXIS] * inverse_millimeters;
+        unit_vec[Y_AXIS] = delta_mm[Y_HEAD] * inverse_millimeters;
+        unit_vec[Z_AXIS] = delta_mm[Z_HEAD] * inverse_millimeters;
+      #else
+        LOOP_XYZ(i) unit_vec[i] = delta_mm[i] * inverse_millimeters;
+      #endif
+      unit_vec[E_AXIS] = delta_mm[E_AXIS] * inverse_millimeters;
+    }
+
+    const bool prev_has_xyz = previous_unit_vec[X_AXIS] || previous_unit_vec[Y_AXIS] || previous_unit_vec[Z_AXIS];
+
+    // Compute cosine of angle between previous and current path. (prev_unit_vec is negative)
+    const float junction_cos_theta = - previous_unit_vec[X_AXIS] * unit_vec[X_AXIS]
+                                     - previous_unit_vec[Y_AXIS] * unit_vec[Y_AXIS]
+                                     - previous_unit_vec[Z_AXIS] * unit_vec[Z_AXIS];
+
+    // The extruder speed changes by this much per mm/s of junction speed
+    const float e_jerk_per_speed = fabs(unit_vec[E_AXIS] - previous_unit_vec[E_AXIS]);
+
+    memcpy(previous_unit_vec, unit_vec, sizeof(previous_unit_vec));
+
+    /**
+     * Compute maximum allowable entry speed at junction by centripetal acceleration approximation.
+     *
+     * Let a circle be tangent to both previous and current path line segments, where the junction
+     * deviation is defined as the distance from the junction to the closest edge of the circle,
+     * collinear with the circle center. The circular segment joining the two paths represents the
+     * path of centripetal acceleration. Solve for max velocity based on max acceleration about the
+     * radius of the circle, defined indirectly by junction deviation.
+     *
+     * This replaces the XYZ jerk limits. With s = sin(theta/2) the limit is sqrt(a * d * s / (1 - s)),
+     * which is below the speed v only if s * (a * d + v²) < v². Both sides are positive, so that is
+     * tested squared using s² = (1 - cos(theta)) / 2, without sqrt() or a divide. Nearly straight
+     * junctions, as found on segmented curves, end there. Only real corners pay for two sqrt() calls.
+     *
+     * The E jerk still applies, as the extrusion rate changes at a junction wherever the E distance
+     * per mm of path does.
+     */
+    if (moves_queued > 1 && previous_nominal_speed > 0.0001 && has_xyz && prev_has_xyz) {
+      // A 0 degree acute junction is a full reversal
+      if (junction_cos_theta > 0.999999)
+        vmax_junction = MINIMUM_PLANNER_SPEED;
+      else {
+        // The junction velocity will be shared between successive segments. Limit it to their minimum.
+        vmax_junction = min(previous_nominal_speed, block->nominal_speed);
+        const float accel_deviation = acceleration * junction_deviation_mm,
+                    v_sq = sq(vmax_junction),
+                    sin_theta_d2_sq = 0.5 * (1.0 - junction_cos_theta); // Trig half angle identity
+        if (sin_theta_d2_sq * sq(accel_deviation + v_sq) < sq(v_sq)) {
+          const float sin_theta_d2 = sqrt(sin_theta_d2_sq);
+          vmax_junction = sqrt(accel_deviation * sin_theta_d2 / (1.0 - sin_theta_d2));
+        }
+        if (e_jerk_per_speed * vmax_junction > max_jerk[E_AXIS])
+          vmax_junction = max_jerk[E_AXIS] / e_jerk_per_speed;
+      }
+    }
+    else {
+      // First move, or a move without XYZ motion (E only) on either side: start from a full halt
+      SBI(block->flag, BLOCK_BIT_START_FROM_FULL_HALT);
+      vmax_junction = safe_speed;
+    }
+
+  #else // !JUNCTION_DEVIATION
+
   if (moves_queued > 1 && previous_nominal_speed > 0.0001) {
     // Estimate a maximum velocity allowed at a joint of two successive segments.
     // If this maximum velocity allowed is lower than the minimum of the entry / exit safe velocities,
@@ -1281,11 +1499,15 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
     vmax_junction = safe_speed;
   }
 
+  #endif // !JUNCTION_DEVIATION
+
   // Max entry speed of this block equals the max exit speed of the previous block.
-  block->max_entry_speed = vmax_junction;
+  // Rounded down to what the block stores, so entry_speed can still match it.
+  block->max_entry_ratio = min(vmax_junction / block->nominal_speed * 65536.0, 65535.0);
+  vmax_junction = max_entry_speed(block);
 
   // Initialize block entry speed. Compute based on deceleration to user-defined MINIMUM_PLANNER_SPEED.
-  float v_allowable = max_allowable_speed(-block->acceleration, MINIMUM_PLANNER_SPEED, block->millimeters);
+  float v_allowable = max_allowable_speed(block->accel_mm_x2, MINIMUM_PLANNER_SPEED);
   block->entry_speed = min(vmax_junction, v_allowable);
 
   // Initialize planner efficiency flags
@@ -1330,7 +1552,7 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
       block->advance = 0;
     }
     else {
-      long acc_dist = estimate_acceleration_distance(0, block->nominal_rate, block->acceleration_steps_per_s2);
+      long acc_dist = estimate_acceleration_distance(0, block->nominal_rate, accel);
       float advance = ((STEPS_PER_CUBIC_MM_E) * (EXTRUDER_ADVANCE_K)) * HYPOT(current_speed[E_AXIS], EXTRUSION_AREA) * 256;
       block->advance = advance;
       block->advance_rate = acc_dist ? advance / (float)acc_dist : 0;
@@ -1347,6 +1569,11 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
 
   calculate_trapezoid_for_block(block, block->entry_speed / block->nominal_speed, safe_speed / block->nominal_speed);
 
+  // Keep the temperature ISR from locking blocks until the plan is updated
+  #if ENABLED(STEP_SEGMENT_BUFFER)
+    stepper.prep_busy = true;
+  #endif
+
   // Move buffer head
   block_buffer_head = next_buffer_head;
 
@@ -1355,8 +1582,19 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
 
   recalculate();
 
+  #if ENABLED(STEP_SEGMENT_BUFFER)
+    stepper.prep_busy = false;
+  #endif
+
   stepper.wake_up();
 
+  #if ENABLED(PLANNER_PROFILING)
+    const uint32_t us = micros() - profile_start_us;
+    profile_buffer_line_us += us;
+    NOLESS(profile_buffer_line_max_us, us);
+    profile_blocks++;
+  #endif
+
 } // buffer_line()
 
 /**
@@ -1367,6 +1605,9 @@ void Planner::_buffer_line(const float &a, const float &b, const float &c, const
  */
 
 void Planner::_set_position_mm(const float &a, const float &b, const float &c, const float &e) {
+  #if ENABLED(SEGMENT_COALESCING)
+    flush_coalesced_move();
+  #endif
   #if ENABLED(DISTINCT_E_FACTORS)
     #define _EINDEX (E_AXIS + active_extruder)
     last_extruder = active_extruder;
@@ -1408,6 +1649,9 @@ void Planner::sync_from_steppers() {
  * Setters for planner position (also setting stepper position).
  */
 void Planner::set_position_mm(const AxisEnum axis, const float& v) {
+  #if ENABLED(SEGMENT_COALESCING)
+    flush_coalesced_move();
+  #endif
   #if ENABLED(DISTINCT_E_FACTORS)
     const uint8_t axis_index = axis + (axis == E_AXIS ? active_extruder : 0);
     last_extruder = active_extruder;
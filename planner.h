@@ -40,6 +40,10 @@
   #include "vector_3.h"
 #endif
 
+#if ENABLED(PLANNER_FIXED_POINT)
+  #include "acceleration_steps.h"
+#endif
+
 enum BlockFlagBit {
   // Recalculate trapezoids on entry junction. For optimization.
   BLOCK_BIT_RECALCULATE,
@@ -88,7 +92,7 @@ typedef struct {
 
   int32_t accelerate_until,                 // The index of the step event on which to stop acceleration
           decelerate_after,                 // The index of the step event on which to start decelerating
-          acceleration_rate;                // The acceleration rate used for acceleration calculation
+          acceleration_rate;                // The acceleration in steps/s² * 2^24 / stepper timer ticks per second
 
   uint8_t direction_bits;                   // The direction bit set for this block (refers to *_DIRECTION_BIT in config.h)
 
@@ -106,22 +110,33 @@ typedef struct {
   // Fields used by the motion planner to manage acceleration
   float nominal_speed,                      // The nominal speed for this block in mm/sec
         entry_speed,                        // Entry speed at previous-current junction in mm/sec
-        max_entry_speed,                    // Maximum allowable junction entry speed in mm/sec
-        millimeters,                        // The total travel of this block in mm
-        acceleration;                       // acceleration mm/sec^2
+        accel_mm_x2;                        // 2 * acceleration * millimeters, the most speed² can change in this block
+  uint16_t max_entry_ratio;                 // Maximum allowable junction entry speed, in 1/65536ths of nominal_speed
 
-  // Settings for the trapezoid generator
-  uint32_t nominal_rate,                    // The nominal step rate for this block in step_events/sec
+  // Settings for the trapezoid generator. The stepper ISR works with 16-bit step rates.
+  uint16_t nominal_rate,                    // The nominal step rate for this block in step_events/sec
            initial_rate,                    // The jerk-adjusted step rate at start of block
-           final_rate,                      // The minimal rate at exit
-           acceleration_steps_per_s2;       // acceleration steps/sec^2
+           final_rate;                      // The minimal rate at exit
+
+  #if ENABLED(PLANNER_FIXED_POINT)
+    uint32_t acceleration_steps_inverse;    // 2^(32 + shift) / (2 * acceleration_steps_per_s2), normalized to 32 bits
+    uint8_t acceleration_steps_shift;       // The shift that goes with acceleration_steps_inverse
+  #endif
+
+  #if ENABLED(S_CURVE_ACCELERATION)
+    uint16_t cruise_rate;                   // The peak step rate, reached at the end of acceleration
+    uint32_t acceleration_time,             // Duration of the acceleration phase in stepper timer ticks
+             deceleration_time,             // Duration of the deceleration phase in stepper timer ticks
+             acceleration_time_inverse,     // 2^32 / acceleration_time, to avoid a divide in the ISR
+             deceleration_time_inverse;     // 2^32 / deceleration_time
+  #endif
 
   #if FAN_COUNT > 0
-    uint16_t fan_speed[FAN_COUNT];
+    uint8_t fan_speed[FAN_COUNT];
   #endif
 
   #if ENABLED(BARICUDA)
-    uint32_t valve_pressure, e_to_p_pressure;
+    uint8_t valve_pressure, e_to_p_pressure;
   #endif
   
   #if ENABLED(ENSURE_SMOOTH_MOVES)
@@ -142,6 +157,7 @@ class Planner {
     static block_t block_buffer[BLOCK_BUFFER_SIZE];
     static volatile uint8_t block_buffer_head,  // Index of the next block to be pushed
                             block_buffer_tail;
+    static uint8_t block_buffer_planned;        // Index of the newest block whose entry speed is final
 
     #if ENABLED(DISTINCT_E_FACTORS)
       static uint8_t last_extruder;             // Respond to extruder change
@@ -161,6 +177,10 @@ class Planner {
                  max_jerk[XYZE],       // The largest speed change requiring no acceleration
                  min_travel_feedrate_mm_s;
 
+    #if ENABLED(JUNCTION_DEVIATION)
+      static float junction_deviation_mm; // Distance from a junction to the arc used for its speed limit. M205 J
+    #endif
+
     #if HAS_ABL
       static bool abl_enabled;            // Flag that bed leveling is enabled
       static matrix_3x3 bed_level_matrix; // Transform to compensate for bed level
@@ -187,6 +207,14 @@ class Planner {
      * Nominal speed of previous path line segment
      */
     static float previous_nominal_speed;
+
+    #if ENABLED(JUNCTION_DEVIATION)
+      /**
+       * Unit vector of previous path line segment (zero if it had no XYZ motion),
+       * and its E distance per mm of path
+       */
+      static float previous_unit_vec[NUM_AXIS];
+    #endif
 	
     /**
      * Limit where 64bit math is necessary for acceleration calculation
@@ -218,6 +246,15 @@ class Planner {
       static uint32_t block_buffer_runtime_us; //Theoretical block buffer runtime in µs
     #endif
 
+    #if ENABLED(PLANNER_PROFILING)
+      static uint32_t profile_blocks,             // Blocks added since the last reset
+                      profile_buffer_line_us,     // Total time spent in _buffer_line()
+                      profile_buffer_line_max_us, // Longest _buffer_line() call
+                      profile_recalculate_us,     // Total time spent in recalculate()
+                      profile_recalculate_max_us; // Longest recalculate() call
+      static millis_t profile_start_ms;           // Time of the last reset
+    #endif
+
   public:
 
     /**
@@ -374,6 +411,28 @@ class Planner {
         block_buffer_tail = BLOCK_MOD(block_buffer_tail + 1);
     }
 
+    #if ENABLED(STEP_SEGMENT_BUFFER)
+
+      /**
+       * Whether more planning can no longer change the trapezoid of the
+       * block at the given index, since the entry speed after it is final.
+       */
+      static bool is_block_final(const uint8_t b) {
+        const uint8_t tail = block_buffer_tail, planned = BLOCK_MOD(block_buffer_planned - tail);
+        return planned < BLOCK_MOD(block_buffer_head - tail) && BLOCK_MOD(b - tail) < planned;
+      }
+
+      /**
+       * Mark the block at the given index busy, before the stepper gets to it.
+       * The entry speed of the next block is its exit speed, so freeze it too.
+       */
+      static void lock_block(const uint8_t b) {
+        if (!is_block_final(b)) block_buffer_planned = next_block_index(b);
+        SBI(block_buffer[b].flag, BLOCK_BIT_BUSY);
+      }
+
+    #endif
+
     /**
      * The current block. NULL if the buffer is empty.
      * This also marks the block as busy.
@@ -414,13 +473,21 @@ class Planner {
       static void autotemp_M104_M109();
     #endif
 
+    #if ENABLED(PLANNER_PROFILING)
+      static bool profile_dump_trapezoids; // M801 D1: Echo each trapezoid once it has run
+      static uint8_t profile_dump_index;   // The oldest block not yet echoed
+      static void profile_reset();
+      static void profile_report();
+      static void profile_dump();
+    #endif
+
   private:
 
     /**
      * Get the index of the next / previous block in the ring buffer
      */
-    static int8_t next_block_index(int8_t block_index) { return BLOCK_MOD(block_index + 1); }
-    static int8_t prev_block_index(int8_t block_index) { return BLOCK_MOD(block_index - 1); }
+    static uint8_t next_block_index(const uint8_t block_index) { return BLOCK_MOD(block_index + 1); }
+    static uint8_t prev_block_index(const uint8_t block_index) { return BLOCK_MOD(block_index - 1); }
 
     /**
      * Calculate the distance (not time) it takes to accelerate
@@ -445,14 +512,32 @@ class Planner {
     }
 
     /**
-     * Calculate the maximum allowable speed at this point, in order
-     * to reach 'target_velocity' using 'acceleration' within a given
-     * 'distance'.
+     * Calculate the maximum allowable speed at the start of a block, in order
+     * to reach 'target_velocity' at its end, where 'accel_mm_x2' is
+     * 2 * acceleration * distance for the block.
      */
-    static float max_allowable_speed(const float &accel, const float &target_velocity, const float &distance) {
-      return sqrt(sq(target_velocity) - 2 * accel * distance);
+    static float max_allowable_speed(const float &accel_mm_x2, const float &target_velocity) {
+      return sqrt(sq(target_velocity) + accel_mm_x2);
     }
 
+    /**
+     * The maximum junction entry speed of a block in mm/sec. It is stored as
+     * a 16-bit fraction of nominal_speed, which it never exceeds.
+     */
+    static float max_entry_speed(const block_t* const block) {
+      return block->nominal_speed * (block->max_entry_ratio * (1.0 / 65536.0));
+    }
+
+    #if ENABLED(PLANNER_FIXED_POINT)
+      // Integer versions of estimate_acceleration_distance() and intersection_distance()
+      static int32_t acceleration_steps_fixed(const block_t* const block, const uint32_t initial_rate, const uint32_t target_rate, const bool round_up) {
+        return acceleration_steps(block->acceleration_steps_inverse, block->acceleration_steps_shift, initial_rate, target_rate, round_up);
+      }
+      static int32_t intersection_steps_fixed(const block_t* const block, const uint32_t initial_rate, const uint32_t final_rate) {
+        return intersection_steps(block->acceleration_steps_inverse, block->acceleration_steps_shift, block->step_event_count, initial_rate, final_rate);
+      }
+    #endif
+
     static void calculate_trapezoid_for_block(block_t* const block, const float &entry_factor, const float &exit_factor);
 
     static void reverse_pass_kernel(block_t* const current, const block_t *next);
@@ -461,7 +546,7 @@ class Planner {
     static void reverse_pass();
     static void forward_pass();
 
-    static void recalculate_trapezoids();
+    static void recalculate_trapezoids(const uint8_t first);
 
     static void recalculate();
 
@@ -118,9 +118,60 @@ volatile signed char Stepper::count_direction[NUM_AXIS] = { 1, 1, 1, 1 };
 #endif
 
 unsigned short Stepper::acc_step_rate; // needed for deceleration start point
+
+#if ENABLED(S_CURVE_ACCELERATION)
+  unsigned short Stepper::bezier_start_rate,
+                 Stepper::bezier_end_rate;
+  uint32_t Stepper::bezier_time_inverse;
+  bool Stepper::bezier_2nd_half;
+#endif
 uint8_t Stepper::step_loops, Stepper::step_loops_nominal;
 unsigned short Stepper::OCR1A_nominal;
 
+#if ENABLED(STEP_SEGMENT_BUFFER)
+  segment_t Stepper::segment_buffer[STEP_SEGMENT_BUFFER_SIZE];
+  volatile uint8_t Stepper::segment_buffer_head = 0,
+                   Stepper::segment_buffer_tail = 0;
+  uint16_t Stepper::segment_steps_left = 0,
+           Stepper::OCR1A_segment;
+  volatile bool Stepper::prep_reset = false;
+  bool Stepper::prep_active = false;
+  uint8_t Stepper::prep_block_index = 0;
+  uint32_t Stepper::prep_step;
+  float Stepper::prep_rate;
+  volatile bool Stepper::prep_busy = false;
+  volatile uint16_t Stepper::segment_underruns = 0;
+  bool Stepper::segment_starved = false;
+  #if ENABLED(REALTIME_COMMANDS)
+    volatile bool Stepper::feed_hold = false;
+    bool Stepper::prep_limited = false;
+    float Stepper::prep_speed_limit;
+  #endif
+#endif
+
+#if ENABLED(ISR_PROFILING)
+  uint32_t Stepper::profile_count = 0,
+           Stepper::profile_ticks = 0,
+           Stepper::profile_overruns = 0,
+           Stepper::profile_loops[3] = { 0 };
+  uint16_t Stepper::profile_min_ticks = 0xFFFF,
+           Stepper::profile_max_ticks = 0;
+#endif
+
+#if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+  uint8_t Stepper::amass_level, Stepper::amass_level_nominal;
+  long Stepper::amass_steps[NUM_AXIS],
+       Stepper::amass_event_increment,
+       Stepper::amass_step_event_count,
+       Stepper::amass_counter;
+
+  #define STEP_INCREMENT(AXIS) amass_steps[AXIS]
+  #define STEP_EVENT_COUNT amass_step_event_count
+#else
+  #define STEP_INCREMENT(AXIS) current_block->steps[AXIS]
+  #define STEP_EVENT_COUNT current_block->step_event_count
+#endif
+
 volatile long Stepper::endstops_trigsteps[XYZ];
 
 #if ENABLED(X_DUAL_STEPPER_DRIVERS)
@@ -331,6 +382,10 @@ void Stepper::set_directions() {
 ISR(TIMER1_COMPA_vect) { Stepper::isr(); }
 
 void Stepper::isr() {
+  #if ENABLED(ISR_PROFILING)
+    const uint16_t profile_start = TCNT1, profile_ocr = OCR1A;
+  #endif
+
   //Disable Timer0 ISRs and enable global ISR again to capture UART events (incoming chars)
   #if ENABLED(ADVANCE) || ENABLED(LIN_ADVANCE)
     CBI(TIMSK0, OCIE0A); //estepper ISR
@@ -343,6 +398,11 @@ void Stepper::isr() {
     --cleaning_buffer_counter;
     current_block = NULL;
     planner.discard_current_block();
+    #if ENABLED(STEP_SEGMENT_BUFFER)
+      segment_buffer_tail = segment_buffer_head;
+      segment_steps_left = 0;
+      prep_reset = true;
+    #endif
     #ifdef SD_FINISHED_RELEASECOMMAND
       if (!cleaning_buffer_counter && (SD_FINISHED_STEPPERRELEASE)) enqueue_and_echo_commands_P(PSTR(SD_FINISHED_RELEASECOMMAND));
     #endif
@@ -364,7 +424,10 @@ void Stepper::isr() {
       trapezoid_generator_reset();
 
       // Initialize Bresenham counters to 1/2 the ceiling
-      counter_X = counter_Y = counter_Z = counter_E = -(current_block->step_event_count >> 1);
+      counter_X = counter_Y = counter_Z = counter_E = -(STEP_EVENT_COUNT >> 1);
+      #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+        amass_counter = counter_X;
+      #endif
 
       #if ENABLED(MIXING_EXTRUDER)
         MIXING_STEPPERS_LOOP(i)
@@ -406,6 +469,39 @@ void Stepper::isr() {
     }
   }
 
+  #if ENABLED(STEP_SEGMENT_BUFFER)
+    // Load the next segment, skipping any left from a block that was cut short
+    if (!segment_steps_left) {
+      const uint8_t block_index = planner.block_buffer_tail;
+      while (segment_buffer_tail != segment_buffer_head && segment_buffer[segment_buffer_tail].block_index != block_index)
+        segment_buffer_tail = SEGMENT_MOD(segment_buffer_tail + 1);
+      if (segment_buffer_tail == segment_buffer_head) {
+        // Running dry in the middle of a block stops the axes at speed
+        if (!segment_starved) {
+          segment_starved = true;
+          if (step_events_completed
+            #if ENABLED(REALTIME_COMMANDS)
+              && !feed_hold
+            #endif
+          ) segment_underruns++;
+        }
+        OCR1A = 200; // The main loop hasn't prepared it yet. Check again in 100µs.
+        SBI(TIMSK0, OCIE0B);
+        ENABLE_STEPPER_DRIVER_INTERRUPT();
+        return;
+      }
+      segment_starved = false;
+      const segment_t* const segment = &segment_buffer[segment_buffer_tail];
+      segment_steps_left = segment->step_events;
+      step_loops = segment->step_loops;
+      OCR1A_segment = segment->timer;
+      #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+        amass_set_level(segment->amass_level);
+      #endif
+      segment_buffer_tail = SEGMENT_MOD(segment_buffer_tail + 1);
+    }
+  #endif
+
   // Update endstops state, if enabled
   if ((endstops.enabled
     #if HAS_BED_PROBE
@@ -423,14 +519,18 @@ void Stepper::isr() {
     #endif
   }
 
+  #if ENABLED(ISR_PROFILING)
+    profile_loops[step_loops >> 1]++;
+  #endif
+
   // Take multiple steps per interrupt (For high speed moves)
   bool all_steps_done = false;
   for (int8_t i = 0; i < step_loops; i++) {
     #if ENABLED(LIN_ADVANCE)
 
-      counter_E += current_block->steps[E_AXIS];
+      counter_E += STEP_INCREMENT(E_AXIS);
       if (counter_E > 0) {
-        counter_E -= current_block->step_event_count;
+        counter_E -= STEP_EVENT_COUNT;
         #if DISABLED(MIXING_EXTRUDER)
           // Don't step E here for mixing extruder
           count_position[E_AXIS] += count_direction[E_AXIS];
@@ -453,9 +553,9 @@ void Stepper::isr() {
     #elif ENABLED(ADVANCE)
 
       // Always count the unified E axis
-      counter_E += current_block->steps[E_AXIS];
+      counter_E += STEP_INCREMENT(E_AXIS);
       if (counter_E > 0) {
-        counter_E -= current_block->step_event_count;
+        counter_E -= STEP_EVENT_COUNT;
         #if DISABLED(MIXING_EXTRUDER)
           // Don't step E here for mixing extruder
           motor_direction(E_AXIS) ? --e_steps[TOOL_E_INDEX] : ++e_steps[TOOL_E_INDEX];
@@ -484,13 +584,13 @@ void Stepper::isr() {
 
     // Advance the Bresenham counter; start a pulse if the axis needs a step
     #define PULSE_START(AXIS) \
-      _COUNTER(AXIS) += current_block->steps[_AXIS(AXIS)]; \
+      _COUNTER(AXIS) += STEP_INCREMENT(_AXIS(AXIS)); \
       if (_COUNTER(AXIS) > 0) { _APPLY_STEP(AXIS)(!_INVERT_STEP_PIN(AXIS),0); }
 
     // Stop an active pulse, reset the Bresenham counter, update the position
     #define PULSE_STOP(AXIS) \
       if (_COUNTER(AXIS) > 0) { \
-        _COUNTER(AXIS) -= current_block->step_event_count; \
+        _COUNTER(AXIS) -= STEP_EVENT_COUNT; \
         count_position[_AXIS(AXIS)] += count_direction[_AXIS(AXIS)]; \
         _APPLY_STEP(AXIS)(_INVERT_STEP_PIN(AXIS),0); \
       }
@@ -517,7 +617,7 @@ void Stepper::isr() {
     #if DISABLED(ADVANCE) && DISABLED(LIN_ADVANCE)
       #if ENABLED(MIXING_EXTRUDER)
         // Keep updating the single E axis
-        counter_E += current_block->steps[E_AXIS];
+        counter_E += STEP_INCREMENT(E_AXIS);
         // Tick the counters used for this mix
         MIXING_STEPPERS_LOOP(j) {
           // Step mixing steppers (proportionally)
@@ -549,7 +649,7 @@ void Stepper::isr() {
       #if ENABLED(MIXING_EXTRUDER)
         // Always step the single E axis
         if (counter_E > 0) {
-          counter_E -= current_block->step_event_count;
+          counter_E -= STEP_EVENT_COUNT;
           count_position[E_AXIS] += count_direction[E_AXIS];
         }
         MIXING_STEPPERS_LOOP(j) {
@@ -563,10 +663,21 @@ void Stepper::isr() {
       #endif
     #endif // !ADVANCE && !LIN_ADVANCE
 
+    #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+      // Only count whole step events of the longest axis
+      amass_counter += amass_event_increment;
+      if (amass_counter <= 0) continue;
+      amass_counter -= amass_step_event_count;
+    #endif
+
     if (++step_events_completed >= current_block->step_event_count) {
       all_steps_done = true;
       break;
     }
+
+    #if ENABLED(STEP_SEGMENT_BUFFER)
+      if (!--segment_steps_left) break;
+    #endif
   }
 
   #if ENABLED(LIN_ADVANCE)
@@ -589,14 +700,26 @@ void Stepper::isr() {
     if (e_steps[TOOL_E_INDEX]) OCR0A = TCNT0 + 2;
   #endif
 
+  #if ENABLED(STEP_SEGMENT_BUFFER)
+
+    OCR1A = OCR1A_segment;
+
+  #else
+
   // Calculate new timer value
   if (step_events_completed <= (uint32_t)current_block->accelerate_until) {
 
-    MultiU24X32toH16(acc_step_rate, acceleration_time, current_block->acceleration_rate);
-    acc_step_rate += current_block->initial_rate;
+    #if ENABLED(S_CURVE_ACCELERATION)
+      acc_step_rate = (uint32_t)acceleration_time < current_block->acceleration_time
+        ? _eval_bezier_curve(acceleration_time)
+        : current_block->cruise_rate;
+    #else
+      MultiU24X32toH16(acc_step_rate, acceleration_time, current_block->acceleration_rate);
+      acc_step_rate += current_block->initial_rate;
 
-    // upper limit
-    NOMORE(acc_step_rate, current_block->nominal_rate);
+      // upper limit
+      NOMORE(acc_step_rate, current_block->nominal_rate);
+    #endif
 
     // step_rate to timer interval
     uint16_t timer = calc_timer(acc_step_rate);
@@ -642,14 +765,26 @@ void Stepper::isr() {
   }
   else if (step_events_completed > (uint32_t)current_block->decelerate_after) {
     uint16_t step_rate;
-    MultiU24X32toH16(step_rate, deceleration_time, current_block->acceleration_rate);
 
-    if (step_rate < acc_step_rate) { // Still decelerating?
-      step_rate = acc_step_rate - step_rate;
-      NOLESS(step_rate, current_block->final_rate);
-    }
-    else
-      step_rate = current_block->final_rate;
+    #if ENABLED(S_CURVE_ACCELERATION)
+      // Load the deceleration curve on the first decelerating step
+      if (!bezier_2nd_half) {
+        _calc_bezier_curve_coeffs(current_block->cruise_rate, current_block->final_rate, current_block->deceleration_time_inverse);
+        bezier_2nd_half = true;
+      }
+      step_rate = (uint32_t)deceleration_time < current_block->deceleration_time
+        ? _eval_bezier_curve(deceleration_time)
+        : current_block->final_rate;
+    #else
+      MultiU24X32toH16(step_rate, deceleration_time, current_block->acceleration_rate);
+
+      if (step_rate < acc_step_rate) { // Still decelerating?
+        step_rate = acc_step_rate - step_rate;
+        NOLESS(step_rate, current_block->final_rate);
+      }
+      else
+        step_rate = current_block->final_rate;
+    #endif
 
     // step_rate to timer interval
     uint16_t timer = calc_timer(step_rate);
@@ -705,15 +840,32 @@ void Stepper::isr() {
     OCR1A = OCR1A_nominal;
     // ensure we're running at the correct step rate, even if we just came off an acceleration
     step_loops = step_loops_nominal;
+    #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+      amass_set_level(amass_level_nominal);
+    #endif
   }
 
+  #endif // !STEP_SEGMENT_BUFFER
+
+  #if ENABLED(ISR_PROFILING)
+    const bool overrun = OCR1A < TCNT1 + 16;
+  #endif
+
   NOLESS(OCR1A, TCNT1 + 16);
 
   // If current block is finished, reset pointer
   if (all_steps_done) {
     current_block = NULL;
     planner.discard_current_block();
+    #if ENABLED(STEP_SEGMENT_BUFFER)
+      segment_steps_left = 0;
+    #endif
   }
+
+  #if ENABLED(ISR_PROFILING)
+    profile_isr(profile_start, profile_ocr, overrun);
+  #endif
+
   #if ENABLED(ADVANCE) || ENABLED(LIN_ADVANCE)
     SBI(TIMSK0, OCIE0A);
   #endif
@@ -721,6 +873,65 @@ void Stepper::isr() {
   ENABLE_STEPPER_DRIVER_INTERRUPT();
 }
 
+#if ENABLED(ISR_PROFILING)
+
+  /**
+   * Time a stepping interrupt, from its entry to re-enabling the timer.
+   *
+   * Timer 1 restarts at each compare match. While the stepper interrupt
+   * is disabled a match leaves OCF1A pending, and then the count restarted
+   * at the OCR1A in effect on entry.
+   */
+  void Stepper::profile_isr(const uint16_t start, const uint16_t ocr, bool overrun) {
+    CRITICAL_SECTION_START;
+    uint16_t ticks = TCNT1 - start;
+    if (TEST(TIFR1, OCF1A)) {
+      ticks += ocr + 1;
+      overrun = true;
+    }
+    profile_count++;
+    profile_ticks += ticks;
+    NOMORE(profile_min_ticks, ticks);
+    NOLESS(profile_max_ticks, ticks);
+    if (overrun) profile_overruns++;
+    CRITICAL_SECTION_END;
+  }
+
+  void Stepper::profile_reset() {
+    CRITICAL_SECTION_START;
+    profile_count = profile_ticks = profile_overruns = 0;
+    ZERO(profile_loops);
+    profile_min_ticks = 0xFFFF;
+    profile_max_ticks = 0;
+    CRITICAL_SECTION_END;
+  }
+
+  /**
+   * Report the stepping interrupt durations since the last reset, in
+   * microseconds, with how often each step_loops value was used.
+   * Interrupts that only wait for a block or segment aren't timed.
+   */
+  void Stepper::profile_report() {
+    CRITICAL_SECTION_START;
+    const uint32_t count = profile_count, ticks = profile_ticks, overruns = profile_overruns,
+                   loops1 = profile_loops[0], loops2 = profile_loops[1], loops4 = profile_loops[2];
+    const uint16_t min_ticks = count ? profile_min_ticks : 0, max_ticks = profile_max_ticks;
+    CRITICAL_SECTION_END;
+    const float us_per_tick = 8000000.0 / (F_CPU);
+    SERIAL_ECHO_START;
+    SERIAL_ECHOPAIR("Stepper ISR count:", (unsigned long)count);
+    SERIAL_ECHOPAIR(" avg:", count ? ticks * us_per_tick / count : 0.0);
+    SERIAL_ECHOPAIR(" min:", min_ticks * us_per_tick);
+    SERIAL_ECHOPAIR(" max:", max_ticks * us_per_tick);
+    SERIAL_ECHOLNPAIR(" overruns:", (unsigned long)overruns);
+    SERIAL_ECHO_START;
+    SERIAL_ECHOPAIR("Step loops 1:", (unsigned long)loops1);
+    SERIAL_ECHOPAIR(" 2:", (unsigned long)loops2);
+    SERIAL_ECHOLNPAIR(" 4:", (unsigned long)loops4);
+  }
+
+#endif // ISR_PROFILING
+
 #if ENABLED(ADVANCE) || ENABLED(LIN_ADVANCE)
 
   // Timer interrupt for E. e_steps is set in the main routine;
@@ -999,7 +1210,155 @@ void Stepper::init() {
 /**
  * Block until all buffered steps are executed
  */
-void Stepper::synchronize() { while (planner.blocks_queued()) idle(); }
+void Stepper::synchronize() {
+  #if ENABLED(SEGMENT_COALESCING)
+    flush_coalesced_move(); // Wait for a held G0/G1 too
+  #endif
+  while (planner.blocks_queued()) idle();
+}
+
+#if ENABLED(STEP_SEGMENT_BUFFER)
+
+  /**
+   * Split the planner blocks into constant-rate segments for the stepper ISR.
+   *
+   * Each segment lasts about 1/STEP_SEGMENTS_PER_SECOND, and runs at the
+   * average of the trapezoid's step rates at its ends. Those follow
+   * rate² = initial_rate² + 2 * accel * steps while accelerating, and the
+   * same from the end of the block while decelerating.
+   *
+   * A block is locked as soon as its trapezoid is final. If the stepper is
+   * about to run out of segments it is locked anyway, as the ISR would have.
+   */
+  void Stepper::prepare_segments() {
+    prep_busy = true;
+    fill_segments((STEP_SEGMENT_BUFFER_SIZE) - 1);
+    prep_busy = false;
+  }
+
+  /**
+   * Called from the temperature ISR. When the main loop is held up (menus,
+   * M500, SD card init...) and the buffer is down to half, prepare a couple
+   * of segments per tick in its place, so the planned deceleration still
+   * runs. Skipped while the main loop is preparing or replanning, since
+   * locking a block moves block_buffer_planned under recalculate().
+   */
+  void Stepper::refill_segments() {
+    if (segments_queued() >= (STEP_SEGMENT_BUFFER_SIZE) / 2) return;
+    CRITICAL_SECTION_START;
+      const bool busy = prep_busy;
+      prep_busy = true;
+    CRITICAL_SECTION_END;
+    if (busy) return;
+    fill_segments(2);
+    prep_busy = false;
+  }
+
+  void Stepper::fill_segments(const uint8_t count) {
+    const float segment_time = 1.0 / (STEP_SEGMENTS_PER_SECOND);
+
+    for (uint8_t n = count; n--;) {
+      // A block was cut short. Start over with whatever the stepper runs next,
+      // dropping a segment that was added while the stepper dropped the rest.
+      if (prep_reset) {
+        CRITICAL_SECTION_START;
+          segment_buffer_head = segment_buffer_tail;
+          prep_reset = false;
+        CRITICAL_SECTION_END;
+        prep_active = false;
+        prep_block_index = planner.block_buffer_tail;
+      }
+
+      const uint8_t next_head = SEGMENT_MOD(segment_buffer_head + 1);
+      if (next_head == segment_buffer_tail) return; // Full
+
+      if (!prep_active) {
+        const uint8_t tail = planner.block_buffer_tail;
+        if (BLOCK_MOD(prep_block_index - tail) >= BLOCK_MOD(planner.block_buffer_head - tail)) return; // Nothing new
+        if (!planner.is_block_final(prep_block_index) && segments_queued() >= (STEP_SEGMENT_BUFFER_SIZE) / 2) return;
+        planner.lock_block(prep_block_index);
+        prep_active = true;
+        prep_step = 0;
+        prep_rate = planner.block_buffer[prep_block_index].initial_rate;
+      }
+
+      const block_t* const block = &planner.block_buffer[prep_block_index];
+      const float accel_x2 = block->acceleration_rate * ((F_CPU) * 0.25 / 16777216.0); // 2 * steps/s²
+      const uint32_t accelerate_until = block->accelerate_until,
+                     decelerate_after = block->decelerate_after,
+                     step_event_count = block->step_event_count;
+
+      uint32_t steps, phase_end;
+      float end_rate;
+      if (prep_step < accelerate_until) {
+        phase_end = accelerate_until;
+        steps = constrain(prep_rate * segment_time, 1, phase_end - prep_step);
+        end_rate = min(sqrt(sq((float)block->initial_rate) + accel_x2 * (prep_step + steps)), block->nominal_rate);
+      }
+      else if (prep_step < decelerate_after) {
+        prep_rate = end_rate = block->nominal_rate;
+        phase_end = decelerate_after;
+        steps = constrain(end_rate * segment_time, 1, phase_end - prep_step);
+      }
+      else {
+        // Start from the block's profile, like the plateau, so a resume after a
+        // feed hold isn't held down to the rate it stopped at. prep_speed_limit
+        // clamps it below while the hold ramps.
+        prep_rate = min(max(sqrt(sq((float)block->final_rate) + accel_x2 * (step_event_count - prep_step)), block->final_rate), block->nominal_rate);
+        phase_end = step_event_count;
+        steps = constrain(prep_rate * segment_time, 1, phase_end - prep_step);
+        end_rate = max(sqrt(sq((float)block->final_rate) + accel_x2 * (step_event_count - prep_step - steps)), block->final_rate);
+      }
+
+      #if ENABLED(REALTIME_COMMANDS)
+        // Feed hold: ramp a speed limit down to a stop, and back up on resume
+        if (feed_hold || prep_limited) {
+          const float steps_per_mm = block->nominal_rate / block->nominal_speed;
+          if (!prep_limited) {
+            prep_limited = true;
+            prep_speed_limit = prep_rate / steps_per_mm;
+          }
+          NOMORE(prep_rate, prep_speed_limit * steps_per_mm);
+          const float speed_change = accel_x2 * 0.5 / steps_per_mm * segment_time;
+          if (feed_hold) {
+            prep_speed_limit -= speed_change;
+            if (prep_speed_limit <= 0) { // Stopped. Wait for resume.
+              prep_speed_limit = prep_rate = 0;
+              return;
+            }
+          }
+          else if ((prep_speed_limit += speed_change) >= block->nominal_speed)
+            prep_limited = false;
+          const float limit_rate = prep_speed_limit * steps_per_mm;
+          if (end_rate > limit_rate) {
+            end_rate = limit_rate;
+            steps = constrain((prep_rate + end_rate) * 0.5 * segment_time, 1, phase_end - prep_step);
+          }
+        }
+      #endif
+
+      NOMORE(steps, 65535);
+
+      segment_t* const segment = &segment_buffer[segment_buffer_head];
+      segment->timer = calc_timer((prep_rate + end_rate) * 0.5, segment->step_loops
+        #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+          , segment->amass_level
+        #endif
+      );
+      segment->step_events = steps;
+      segment->block_index = prep_block_index;
+      segment_buffer_head = next_head;
+
+      prep_rate = end_rate;
+      prep_step += steps;
+      if (prep_step >= step_event_count) {
+        prep_active = false;
+        prep_block_index = BLOCK_MOD(prep_block_index + 1);
+      }
+    }
+  }
+
+#endif // STEP_SEGMENT_BUFFER
 
 /**
  * Set the stepper positions directly in steps
@@ -1098,6 +1457,9 @@ void Stepper::finish_and_disable() {
 
 void Stepper::quick_stop() {
   cleaning_buffer_counter = 5000;
+  #if ENABLED(STEP_SEGMENT_BUFFER)
+    prep_reset = true;
+  #endif
   #if ENABLED(ENSURE_SMOOTH_MOVES)
     planner.clear_block_buffer_runtime();
   #endif
@@ -49,9 +49,36 @@
 #include "language.h"
 #include "types.h"
 
+#if ENABLED(S_CURVE_ACCELERATION)
+  #include "bezier_curve.h"
+#endif
+
 class Stepper;
 extern Stepper stepper;
 
+#if ENABLED(STEP_SEGMENT_BUFFER)
+
+  /**
+   * struct segment_t
+   *
+   * A stretch of a planner block run at one step rate.
+   * Prepared in the main loop by Stepper::prepare_segments(), or by
+   * Stepper::refill_segments() in the temperature ISR when it falls behind.
+   */
+  typedef struct {
+    uint16_t timer,       // Stepper timer interval (OCR1A) for these step events
+             step_events; // Number of step events in the segment
+    uint8_t step_loops,   // Step events per interrupt
+            block_index;  // The planner block the segment belongs to
+    #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+      uint8_t amass_level; // Interrupts per step event, as a power of 2
+    #endif
+  } segment_t;
+
+  #define SEGMENT_MOD(n) ((n)&(STEP_SEGMENT_BUFFER_SIZE-1))
+
+#endif
+
 // intRes = intIn1 * intIn2 >> 16
 // uses:
 // r26 to store 0
@@ -124,12 +151,57 @@ class Stepper {
     static long acceleration_time, deceleration_time;
     //unsigned long accelerate_until, decelerate_after, acceleration_rate, initial_rate, final_rate, nominal_rate;
     static unsigned short acc_step_rate; // needed for deceleration start point
+
+    #if ENABLED(S_CURVE_ACCELERATION)
+      static unsigned short bezier_start_rate, bezier_end_rate; // Step rates at both ends of the current curve
+      static uint32_t bezier_time_inverse;                     // 2^32 / duration of the current curve
+      static bool bezier_2nd_half;                             // Set once the deceleration curve is loaded
+    #endif
     static uint8_t step_loops, step_loops_nominal;
     static unsigned short OCR1A_nominal;
 
+    #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+      static uint8_t amass_level, amass_level_nominal; // Interrupts per step event, as a power of 2
+      static long amass_steps[NUM_AXIS],               // Bresenham increments at the current level
+                  amass_event_increment,               // The same, for the step event counter
+                  amass_step_event_count,              // Bresenham ceiling, scaled for the highest level
+                  amass_counter;                       // Counts interrupts into step events
+    #endif
+
+    #if ENABLED(STEP_SEGMENT_BUFFER)
+      static segment_t segment_buffer[STEP_SEGMENT_BUFFER_SIZE];
+      static volatile uint8_t segment_buffer_head,  // Index of the next segment to be prepared
+                              segment_buffer_tail;  // Index of the next segment to run
+      static uint16_t segment_steps_left,           // Step events left in the running segment
+                      OCR1A_segment;                // Timer interval of the running segment
+      static volatile bool prep_reset;              // Set when blocks end early, to restart preparing at the tail
+
+      // State for preparing segments, used by whoever holds prep_busy
+      static bool prep_active;                      // A block is being split into segments
+      static uint8_t prep_block_index;              // The block being split, or the next one to split
+      static uint32_t prep_step;                    // Step events of the block already prepared
+      static float prep_rate;                       // The step rate reached at prep_step
+      static bool segment_starved;                  // The stepper is waiting for a segment
+      static void fill_segments(const uint8_t count);
+      #if ENABLED(REALTIME_COMMANDS)
+        static bool prep_limited;                   // Segments are held to prep_speed_limit
+        static float prep_speed_limit;              // Speed in mm/s, ramping down for a feed hold or up after it
+      #endif
+    #endif
+
     static volatile long endstops_trigsteps[XYZ];
     static volatile long endstops_stepsTotal, endstops_stepsDone;
 
+    #if ENABLED(ISR_PROFILING)
+      static uint32_t profile_count,      // Stepping interrupts timed since the last reset
+                      profile_ticks,      // Their total duration in Timer 1 ticks
+                      profile_overruns,   // Interrupts that ended after the next was due
+                      profile_loops[3];   // Interrupts taking 1, 2 and 4 step events
+      static uint16_t profile_min_ticks,
+                      profile_max_ticks;
+      static void profile_isr(const uint16_t start, const uint16_t ocr, bool overrun);
+    #endif
+
     #if HAS_MOTOR_CURRENT_PWM
       #ifndef PWM_MOTOR_CURRENT
         #define PWM_MOTOR_CURRENT DEFAULT_PWM_MOTOR_CURRENT
@@ -179,6 +251,27 @@ class Stepper {
       static void advance_isr();
     #endif
 
+    #if ENABLED(ISR_PROFILING)
+      static void profile_reset();
+      static void profile_report();
+    #endif
+
+    #if ENABLED(STEP_SEGMENT_BUFFER)
+      //
+      // Fill the segment buffer from the planner. Called from idle().
+      //
+      static void prepare_segments();
+      static void refill_segments();
+      static uint8_t segments_queued() { return SEGMENT_MOD(segment_buffer_head - segment_buffer_tail); }
+
+      static volatile bool prep_busy;             // Segments are being prepared, or the planner is replanning
+      static volatile uint16_t segment_underruns; // Times the stepper ran out of segments in the middle of a block
+
+      #if ENABLED(REALTIME_COMMANDS)
+        static volatile bool feed_hold; // Set to slow down to a stop, cleared to speed up again
+      #endif
+    #endif
+
     //
     // Block until all buffered steps are executed
     //
@@ -262,6 +355,12 @@ class Stepper {
 
     static inline void kill_current_block() {
       step_events_completed = current_block->step_event_count;
+      #if ENABLED(STEP_SEGMENT_BUFFER)
+        // The rest of the block won't run. Drop the segments queued after it
+        // too, since preparing starts over at step 0 of the next block.
+        segment_buffer_tail = segment_buffer_head;
+        prep_reset = true;
+      #endif
     }
 
     //
@@ -278,21 +377,37 @@ class Stepper {
 
   private:
 
-    static FORCE_INLINE unsigned short calc_timer(unsigned short step_rate) {
+    // Get the timer interval for a step rate, and the step events to run per interrupt
+    static FORCE_INLINE unsigned short calc_timer(unsigned short step_rate, uint8_t &loops
+      #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+        , uint8_t &level
+      #endif
+    ) {
       unsigned short timer;
 
       NOMORE(step_rate, MAX_STEP_FREQUENCY);
 
+      #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+        level = 0;
+      #endif
+
       if (step_rate > 20000) { // If steprate > 20kHz >> step 4 times
         step_rate >>= 2;
-        step_loops = 4;
+        loops = 4;
       }
       else if (step_rate > 10000) { // If steprate > 10kHz >> step 2 times
         step_rate >>= 1;
-        step_loops = 2;
+        loops = 2;
       }
       else {
-        step_loops = 1;
+        loops = 1;
+        #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+          // Interrupt more than once per step event while that stays under 10kHz
+          while (level < AMASS_MAX_LEVEL && step_rate <= 5000) {
+            step_rate <<= 1;
+            level++;
+          }
+        #endif
       }
 
       NOLESS(step_rate, F_CPU / 500000);
@@ -317,6 +432,45 @@ class Stepper {
       }
       return timer;
     }
+    #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+
+      // Scale the Bresenham increments for 2^level interrupts per step event
+      static FORCE_INLINE void amass_set_level(const uint8_t level) {
+        if (level == amass_level) return;
+        amass_level = level;
+        const uint8_t shift = AMASS_MAX_LEVEL - level;
+        LOOP_XYZE(i) amass_steps[i] = current_block->steps[i] << shift;
+        amass_event_increment = current_block->step_event_count << shift;
+      }
+
+      static FORCE_INLINE unsigned short calc_timer(unsigned short step_rate) {
+        uint8_t level;
+        const unsigned short timer = calc_timer(step_rate, step_loops, level);
+        amass_set_level(level);
+        return timer;
+      }
+
+    #else
+
+      static FORCE_INLINE unsigned short calc_timer(unsigned short step_rate) { return calc_timer(step_rate, step_loops); }
+
+    #endif
+
+    #if ENABLED(S_CURVE_ACCELERATION)
+
+      // Load the curve going from start_rate to end_rate over the period given by its inverse
+      static FORCE_INLINE void _calc_bezier_curve_coeffs(const unsigned short start_rate, const unsigned short end_rate, const uint32_t time_inverse) {
+        bezier_start_rate = start_rate;
+        bezier_end_rate = end_rate;
+        bezier_time_inverse = time_inverse;
+      }
+
+      // Evaluate the step rate 'elapsed' timer ticks into the current curve
+      static FORCE_INLINE unsigned short _eval_bezier_curve(const uint32_t elapsed) {
+        return eval_bezier_curve(bezier_start_rate, bezier_end_rate, bezier_time_inverse, elapsed);
+      }
+
+    #endif // S_CURVE_ACCELERATION
 
     // Initializes the trapezoid generator from the current block. Called whenever a new
     // block begins.
@@ -330,6 +484,11 @@ class Stepper {
         set_directions();
       }
 
+      #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+        amass_step_event_count = current_block->step_event_count << (AMASS_MAX_LEVEL);
+        amass_level = 0xFF; // Set the increments for this block on the first calc_timer
+      #endif
+
       #if ENABLED(ADVANCE)
 
         advance = current_block->initial_advance;
@@ -350,21 +509,37 @@ class Stepper {
 
       #endif
 
-      deceleration_time = 0;
-      // step_rate to timer interval
-      OCR1A_nominal = calc_timer(current_block->nominal_rate);
-      // make a note of the number of step loops required at nominal speed
-      step_loops_nominal = step_loops;
-      acc_step_rate = current_block->initial_rate;
-      acceleration_time = calc_timer(acc_step_rate);
-      OCR1A = acceleration_time;
-      
-      #if ENABLED(LIN_ADVANCE)
-        if (current_block->use_advance_lead) {
-          current_estep_rate[current_block->active_extruder] = ((unsigned long)acc_step_rate * current_block->abs_adv_steps_multiplier8) >> 17;
-          final_estep_rate = (current_block->nominal_rate * current_block->abs_adv_steps_multiplier8) >> 17;
-        }
-      #endif
+      #if ENABLED(STEP_SEGMENT_BUFFER)
+
+        // Step timing comes from the prepared segments
+        segment_steps_left = 0;
+
+      #else
+
+        deceleration_time = 0;
+        // step_rate to timer interval, and the step loops required at nominal speed
+        OCR1A_nominal = calc_timer(current_block->nominal_rate, step_loops_nominal
+          #if ENABLED(ADAPTIVE_STEP_SMOOTHING)
+            , amass_level_nominal
+          #endif
+        );
+        acc_step_rate = current_block->initial_rate;
+        acceleration_time = calc_timer(acc_step_rate);
+        OCR1A = acceleration_time;
+
+        #if ENABLED(S_CURVE_ACCELERATION)
+          _calc_bezier_curve_coeffs(current_block->initial_rate, current_block->cruise_rate, current_block->acceleration_time_inverse);
+          bezier_2nd_half = false;
+        #endif
+
+        #if ENABLED(LIN_ADVANCE)
+          if (current_block->use_advance_lead) {
+            current_estep_rate[current_block->active_extruder] = ((unsigned long)acc_step_rate * current_block->abs_adv_steps_multiplier8) >> 17;
+            final_estep_rate = (current_block->nominal_rate * current_block->abs_adv_steps_multiplier8) >> 17;
+          }
+        #endif
+
+      #endif // !STEP_SEGMENT_BUFFER
 
       // SERIAL_ECHO_START;
       // SERIAL_ECHOPGM("advance :");
@@ -29,7 +29,7 @@
 #include "temperature.h"
 #include "thermistortables.h"
 #include "language.h"
-#if ENABLED(BABYSTEPPING)
+#if ENABLED(BABYSTEPPING) || ENABLED(STEP_SEGMENT_BUFFER)
   #include "stepper.h"
 #endif
 
@@ -194,6 +194,14 @@ uint8_t Temperature::soft_pwm[HOTENDS];
   int Temperature::current_raw_filwidth = 0;  //Holds measured filament diameter - one extruder only
 #endif
 
+#if ENABLED(ISR_PROFILING)
+  uint32_t Temperature::profile_count = 0,
+           Temperature::profile_ticks = 0,
+           Temperature::profile_overruns = 0;
+  uint16_t Temperature::profile_min_ticks = 0xFFFF,
+           Temperature::profile_max_ticks = 0;
+#endif
+
 #if HAS_PID_HEATING
 
   void Temperature::PID_autotune(float temp, int hotend, int ncycles, bool set_result/*=false*/) {
@@ -1489,6 +1497,10 @@ void Temperature::set_current_temp_raw() {
 ISR(TIMER0_COMPB_vect) { Temperature::isr(); }
 
 void Temperature::isr() {
+  #if ENABLED(ISR_PROFILING)
+    const uint8_t profile_start = TCNT0;
+  #endif
+
   //Allow UART and stepper ISRs
   CBI(TIMSK0, OCIE0B); //Disable Temperature ISR
   sei();
@@ -1943,6 +1955,58 @@ void Temperature::isr() {
       if (!endstop_monitor_count) endstop_monitor();  // report changes in endstop status
     }
   #endif
-  
+
+  #if ENABLED(STEP_SEGMENT_BUFFER)
+    stepper.refill_segments(); // In case the main loop is held up
+  #endif
+
+  #if ENABLED(ISR_PROFILING)
+    // Timer 0 ticks every 64 cycles and overflows between interrupts, so a
+    // pending compare flag means the next interrupt is already late. Once
+    // the count has also passed the entry value a whole period has elapsed.
+    CRITICAL_SECTION_START;
+    const uint8_t profile_end = TCNT0;
+    uint16_t ticks = (uint8_t)(profile_end - profile_start);
+    if (TEST(TIFR0, OCF0B)) {
+      if (profile_end >= profile_start) ticks += 256;
+      profile_overruns++;
+    }
+    profile_count++;
+    profile_ticks += ticks;
+    NOMORE(profile_min_ticks, ticks);
+    NOLESS(profile_max_ticks, ticks);
+    CRITICAL_SECTION_END;
+  #endif
+
   SBI(TIMSK0, OCIE0B); //re-enable Temperature ISR
 }
+
+#if ENABLED(ISR_PROFILING)
+
+  void Temperature::profile_reset() {
+    CRITICAL_SECTION_START;
+    profile_count = profile_ticks = profile_overruns = 0;
+    profile_min_ticks = 0xFFFF;
+    profile_max_ticks = 0;
+    CRITICAL_SECTION_END;
+  }
+
+  /**
+   * Report the Temperature ISR duration since the last reset, in microseconds.
+   * Overruns are included in the durations and also counted on their own.
+   */
+  void Temperature::profile_report() {
+    CRITICAL_SECTION_START;
+    const uint32_t count = profile_count, ticks = profile_ticks, overruns = profile_overruns;
+    const uint16_t min_ticks = count ? profile_min_ticks : 0, max_ticks = profile_max_ticks;
+    CRITICAL_SECTION_END;
+    const float us_per_tick = 64000000.0 / (F_CPU);
+    SERIAL_ECHO_START;
+    SERIAL_ECHOPAIR("Temperature ISR count:", (unsigned long)count);
+    SERIAL_ECHOPAIR(" avg:", count ? ticks * us_per_tick / count : 0.0);
+    SERIAL_ECHOPAIR(" min:", min_ticks * us_per_tick);
+    SERIAL_ECHOPAIR(" max:", max_ticks * us_per_tick);
+    SERIAL_ECHOLNPAIR(" overruns:", (unsigned long)overruns);
+  }
+
+#endif // ISR_PROFILING
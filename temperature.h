@@ -414,8 +414,21 @@ class Temperature {
 
     #endif // BABYSTEPPING
 
+    #if ENABLED(ISR_PROFILING)
+      static void profile_reset();
+      static void profile_report();
+    #endif
+
   private:
 
+    #if ENABLED(ISR_PROFILING)
+      static uint32_t profile_count,      // Interrupts timed since the last reset
+                      profile_ticks,      // Their total duration in Timer 0 ticks
+                      profile_overruns;   // Interrupts that ran past the next one
+      static uint16_t profile_min_ticks,
+                      profile_max_ticks;
+    #endif
+
     static void set_current_temp_raw();
 
     static void updateTemperaturesFromRawValues();
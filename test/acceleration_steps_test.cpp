@@ -0,0 +1,141 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (C) 2016 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * Host test for acceleration_steps.h
+ *
+ * The integer step counts of PLANNER_FIXED_POINT are compared with the
+ * exact values, worked out by integer division, and with the float
+ * estimate_acceleration_distance() and intersection_distance() they
+ * replace, over edge cases and a sweep of random rates and accelerations.
+ * The fixed-point results must be within one step of the exact ones, and
+ * never further from them than the float versions are. Rates are 16-bit,
+ * as in block_t.
+ *
+ *   g++ -std=gnu++11 -O2 -I.. -o acceleration_steps_test acceleration_steps_test.cpp
+ *   ./acceleration_steps_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "acceleration_steps.h"
+
+#define sq(x) ((x)*(x))
+
+// The float versions, as in planner.h
+static float estimate_acceleration_distance(const float &initial_rate, const float &target_rate, const float &accel) {
+  if (accel == 0) return 0;
+  return (sq(target_rate) - sq(initial_rate)) / (accel * 2);
+}
+
+static float intersection_distance(const float &initial_rate, const float &final_rate, const float &accel, const float &distance) {
+  if (accel == 0) return 0;
+  return (accel * 2 * distance - sq(initial_rate) + sq(final_rate)) / (accel * 4);
+}
+
+// Exact floor or ceiling of n / d
+static int64_t divide(const int64_t n, const int64_t d, const bool round_up) {
+  const int64_t q = n / d, r = n % d;
+  if (r && ((r > 0) == round_up)) return q + (round_up ? 1 : -1);
+  return q;
+}
+
+static int64_t clamp(const int64_t steps, const uint32_t step_event_count) {
+  return steps < 0 ? 0 : steps > step_event_count ? step_event_count : steps;
+}
+
+static unsigned long checked, failed, exact, float_misses;
+
+static void fail(const char *what, const uint32_t accel, const uint32_t a, const uint32_t b, const int64_t expected, const int64_t fixed, const int64_t flt) {
+  failed++;
+  printf("FAIL %s a%lu %lu %lu: exact %lld fixed %lld float %lld\n", what,
+    (unsigned long)accel, (unsigned long)a, (unsigned long)b, (long long)expected, (long long)fixed, (long long)flt);
+}
+
+// Compare a fixed-point result with the exact one, allowing one step or the float error
+static void compare(const char *what, const uint32_t accel, const uint32_t a, const uint32_t b, const int64_t expected, const int64_t fixed, const int64_t flt) {
+  checked++;
+  const int64_t miss = llabs(fixed - expected), float_miss = llabs(flt - expected);
+  if (!miss) exact++;
+  if (float_miss) float_misses++;
+  if (miss > 1 && miss > float_miss) fail(what, accel, a, b, expected, fixed, flt);
+}
+
+static void check(const uint32_t accel, const uint32_t initial_rate, const uint32_t target_rate, const uint32_t steps) {
+  const uint8_t shift = acceleration_steps_shift(accel);
+  const uint32_t inverse = acceleration_steps_inverse(accel, shift);
+
+  // The shift stays in range and the inverse keeps 32 significant bits
+  checked++;
+  if (shift > 32 || inverse < 0x80000000UL) {
+    failed++;
+    printf("FAIL a%lu: shift %u inverse 0x%08lx\n", (unsigned long)accel, shift, (unsigned long)inverse);
+  }
+
+  const int64_t rate_sq = (int64_t)target_rate * target_rate - (int64_t)initial_rate * initial_rate;
+
+  // calculate_trapezoid_for_block() rounds acceleration up and deceleration down
+  compare("accelerate", accel, initial_rate, target_rate, divide(rate_sq, 2LL * accel, true),
+    acceleration_steps(inverse, shift, initial_rate, target_rate, true),
+    (int64_t)ceil(estimate_acceleration_distance(initial_rate, target_rate, accel)));
+  compare("decelerate", accel, target_rate, initial_rate, divide(rate_sq, 2LL * accel, false),
+    acceleration_steps(inverse, shift, initial_rate, target_rate, false),
+    (int64_t)floor(estimate_acceleration_distance(target_rate, initial_rate, -(float)accel)));
+
+  // Blocks too short to cruise, from initial_rate to a final target_rate,
+  // limited to the block as calculate_trapezoid_for_block() does
+  compare("intersection", accel, initial_rate, target_rate,
+    clamp(divide(2LL * accel * steps + rate_sq, 4LL * accel, true), steps),
+    clamp(intersection_steps(inverse, shift, steps, initial_rate, target_rate), steps),
+    clamp((int64_t)ceil(intersection_distance(initial_rate, target_rate, accel, steps)), steps));
+}
+
+// Uniform in log scale from 1 to 2^bits
+static uint32_t random_log(const uint8_t bits) {
+  return (uint32_t)exp2((double)rand() / RAND_MAX * bits);
+}
+
+int main() {
+  // Edge cases of the shift and the 64-bit product
+  const uint32_t accels[] = { 1, 2, 3, 0x7FFFFFFFUL, 0x80000000UL, 0xFFFFFFFFUL, 120, 240000, 1600000 };
+  for (const uint32_t accel : accels) {
+    check(accel, 120, 120, 1);
+    check(accel, 120, 65535, 1000000);
+    check(accel, 0, 65535, 0x7FFFFFFFUL);
+    check(accel, 65535, 0, 1);
+    check(accel, 12345, 54321, 20000);
+  }
+
+  // A sweep of random blocks, over step rates up to 65535, accelerations up
+  // to 2^32 steps/s² and lengths up to 2^24 steps
+  srand(1);
+  for (long i = 0; i < 2000000; i++) {
+    const uint32_t accel = random_log(32), steps = random_log(24),
+                   initial_rate = random_log(16) - 1, target_rate = random_log(16) - 1;
+    check(accel ? accel : 1, initial_rate, target_rate, steps ? steps : 1);
+  }
+
+  printf("%lu results checked, %lu failed\n", checked, failed);
+  printf("%.2f%% exact, float versions off by a step or more in %.2f%%\n",
+    exact * 100.0 / (checked * 3 / 4), float_misses * 100.0 / (checked * 3 / 4));
+  return failed ? 1 : 0;
+}
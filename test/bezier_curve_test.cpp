@@ -0,0 +1,297 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (C) 2016 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * Host test for bezier_curve.h
+ *
+ * Each block is planned the way calculate_trapezoid_for_block() does it,
+ * then stepped through the stepper ISR's rate logic twice: once with the
+ * linear ramps and once with S_CURVE_ACCELERATION. The S-curve must run
+ * the same steps in about the same time, and reach the cruise and final
+ * rates at the step events where the trapezoid does, to within 2% more
+ * than the trapezoid misses its own path by. The peak acceleration of the
+ * curves, measured against the linear ramps, is reported as well.
+ *
+ *   g++ -std=gnu++11 -O2 -I.. -o bezier_curve_test bezier_curve_test.cpp
+ *   ./bezier_curve_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "bezier_curve.h"
+
+#define TIMER_RATE 2000000.0   // Timer 1 at F_CPU / 8
+#define MAX_STEP_FREQUENCY 40000
+#define MINIMAL_STEP_RATE 120
+
+#define TOLERANCE 0.02 // Relative to the trapezoid
+
+#define sq(x) ((x)*(x))
+
+struct block {
+  uint32_t step_event_count, accelerate_until, decelerate_after;
+  uint16_t initial_rate, nominal_rate, final_rate, cruise_rate;
+  int32_t acceleration_rate;
+  uint32_t acceleration_time, deceleration_time, acceleration_time_inverse, deceleration_time_inverse;
+};
+
+// The phases of a block as calculate_trapezoid_for_block() sets them
+static void plan(block &b, const uint32_t steps, const uint16_t initial, const uint16_t nominal, const uint16_t final, const float accel_steps_s2) {
+  b.step_event_count = steps;
+  b.nominal_rate = nominal;
+  b.initial_rate = initial < MINIMAL_STEP_RATE ? MINIMAL_STEP_RATE : initial;
+  b.final_rate = final < MINIMAL_STEP_RATE ? MINIMAL_STEP_RATE : final;
+  b.acceleration_rate = (int32_t)(accel_steps_s2 * 16777216.0 / TIMER_RATE);
+
+  const float accel = b.acceleration_rate * (TIMER_RATE / 16777216.0);
+  int32_t accelerate_steps = ceil((sq((float)nominal) - sq((float)b.initial_rate)) / (accel * 2)),
+          decelerate_steps = floor((sq((float)nominal) - sq((float)b.final_rate)) / (accel * 2)),
+          plateau_steps = steps - accelerate_steps - decelerate_steps;
+  uint32_t cruise_rate = nominal;
+  if (plateau_steps < 0) {
+    accelerate_steps = ceil((accel * 2 * steps - sq((float)b.initial_rate) + sq((float)b.final_rate)) / (accel * 4));
+    if (accelerate_steps < 0) accelerate_steps = 0;
+    if ((uint32_t)accelerate_steps > steps) accelerate_steps = steps;
+    plateau_steps = 0;
+    cruise_rate = sqrt(sq((float)b.initial_rate) + 2.0 * accel * accelerate_steps);
+  }
+  b.accelerate_until = accelerate_steps;
+  b.decelerate_after = accelerate_steps + plateau_steps;
+  b.cruise_rate = cruise_rate;
+
+  const float ticks_per_rate = 16777216.0 / b.acceleration_rate;
+  b.acceleration_time = bezier_ramp_time(b.initial_rate, cruise_rate, ticks_per_rate);
+  b.deceleration_time = bezier_ramp_time(b.final_rate, cruise_rate, ticks_per_rate);
+  b.acceleration_time_inverse = bezier_time_inverse(b.acceleration_time);
+  b.deceleration_time_inverse = bezier_time_inverse(b.deceleration_time);
+}
+
+// calc_timer(), with the exact division in place of the lookup tables
+static uint16_t calc_timer(uint32_t rate, uint8_t &loops) {
+  if (rate > MAX_STEP_FREQUENCY) rate = MAX_STEP_FREQUENCY;
+  if (rate > 20000) { rate >>= 2; loops = 4; }
+  else if (rate > 10000) { rate >>= 1; loops = 2; }
+  else loops = 1;
+  if (rate < 32) rate = 32;
+  const uint32_t timer = TIMER_RATE / rate;
+  return timer < 100 ? 100 : timer;
+}
+
+struct run {
+  double accel_end_ticks, // Time of the last accelerating step event
+         end_ticks;       // Time of the last step event
+  uint16_t accel_end_rate, // Rate set on the last accelerating step event
+           last_rate;      // Rate set on the last step event
+  double peak_accel;       // Steepest rate change while accelerating, in steps/s²
+  uint32_t steps;
+};
+
+// The rate logic of Stepper::isr() and trapezoid_generator_reset()
+static run step_block(const block &b, const bool s_curve) {
+  run r = { 0, 0, 0, 0, 0, 0 };
+  uint8_t loops, loops_nominal;
+  const uint16_t timer_nominal = calc_timer(b.nominal_rate, loops_nominal);
+  uint32_t acceleration_time = calc_timer(b.initial_rate, loops), deceleration_time = 0;
+  uint16_t acc_step_rate = b.initial_rate, timer = acceleration_time, rate = b.initial_rate;
+  uint32_t slope_time = 0;
+  uint16_t slope_rate = 0;
+  bool second_half = false;
+  uint16_t curve_start = b.initial_rate, curve_end = b.cruise_rate;
+  uint32_t curve_inverse = b.acceleration_time_inverse;
+  double ticks = 0;
+
+  while (r.steps < b.step_event_count) {
+    r.end_ticks = ticks;
+    r.steps += loops;
+    if (r.steps > b.step_event_count) r.steps = b.step_event_count; // The ISR stops mid-loop
+    if (r.steps <= b.accelerate_until) {
+      if (s_curve)
+        rate = acceleration_time < b.acceleration_time
+          ? eval_bezier_curve(curve_start, curve_end, curve_inverse, acceleration_time)
+          : b.cruise_rate;
+      else {
+        rate = b.initial_rate + (uint16_t)(((uint64_t)acceleration_time * b.acceleration_rate) >> 24);
+        if (rate > b.nominal_rate) rate = b.nominal_rate;
+      }
+      // Rates are whole steps/s, so take the slope over 1/64 of the ramp
+      if (!slope_rate || acceleration_time - slope_time >= b.acceleration_time / 64) {
+        const double accel = slope_rate ? (double)(rate - slope_rate) * TIMER_RATE / (acceleration_time - slope_time) : 0;
+        if (accel > r.peak_accel) r.peak_accel = accel;
+        slope_time = acceleration_time;
+        slope_rate = rate;
+      }
+      acc_step_rate = rate;
+      timer = calc_timer(rate, loops);
+      acceleration_time += timer;
+      r.accel_end_ticks = ticks;
+      r.accel_end_rate = rate;
+    }
+    else if (r.steps > b.decelerate_after) {
+      if (s_curve) {
+        if (!second_half) {
+          curve_start = b.cruise_rate;
+          curve_end = b.final_rate;
+          curve_inverse = b.deceleration_time_inverse;
+          second_half = true;
+        }
+        rate = deceleration_time < b.deceleration_time
+          ? eval_bezier_curve(curve_start, curve_end, curve_inverse, deceleration_time)
+          : b.final_rate;
+      }
+      else {
+        const uint16_t change = ((uint64_t)deceleration_time * b.acceleration_rate) >> 24;
+        rate = change < acc_step_rate ? acc_step_rate - change : b.final_rate;
+        if (rate < b.final_rate) rate = b.final_rate;
+      }
+      timer = calc_timer(rate, loops);
+      deceleration_time += timer;
+    }
+    else {
+      rate = b.nominal_rate;
+      timer = timer_nominal;
+      loops = loops_nominal;
+    }
+    ticks += timer;
+  }
+  r.last_rate = rate;
+  return r;
+}
+
+// Integral of the S-curve's s(t) from 0 to t
+static double curve_area(const double t) { return t * t * t * t * (2.5 - 3 * t + t * t); }
+
+/**
+ * Step events the ideal path covers in the given time, for the linear
+ * ramps of the trapezoid or for the S-curves. Both spend the same time in
+ * each phase, and the S-curve averages to the ramp, so they meet at the
+ * end of every phase.
+ */
+static double path_steps(const block &b, const double ticks, const bool s_curve) {
+  const double a = b.acceleration_rate * (TIMER_RATE / 16777216.0),
+               i = b.initial_rate, c = b.cruise_rate, f = b.final_rate,
+               t_acc = (c - i) / a, t_dec = (c - f) / a,
+               plateau = (double)(b.decelerate_after - b.accelerate_until),
+               t_plateau = plateau / b.nominal_rate;
+  double t = ticks / TIMER_RATE;
+  if (t < t_acc)
+    return i * t + (c - i) * (s_curve ? t_acc * curve_area(t / t_acc) : t * t / (2 * t_acc));
+  const double acc_steps = (i + c) * 0.5 * t_acc;
+  t -= t_acc;
+  if (t < t_plateau) return acc_steps + t * b.nominal_rate;
+  t -= t_plateau;
+  if (t > t_dec) t = t_dec;
+  return acc_steps + plateau + c * t - (c - f) * (s_curve ? t_dec * curve_area(t / t_dec) : t * t / (2 * t_dec));
+}
+
+static unsigned long checked, failed;
+static double worst_error, worst_peak;
+
+/**
+ * Whether the S-curve strays further from its target than the tolerance.
+ * The step-timed ISR can't resolve better than 'slack', and the linear
+ * ramps miss their own path on short, steep ramps, so the curve may miss
+ * by as much as they do.
+ */
+static bool off(const double expected, const double curve, const double linear_miss, const double slack) {
+  const double allowed = linear_miss > slack ? linear_miss : slack,
+               error = (fabs(curve - expected) - allowed) / expected;
+  if (error > worst_error) worst_error = error;
+  return error > TOLERANCE;
+}
+
+static void check(const uint32_t steps, const uint16_t initial, const uint16_t nominal, const uint16_t final, const float accel) {
+  block b;
+  plan(b, steps, initial, nominal, final, accel);
+  const run linear = step_block(b, false), curve = step_block(b, true);
+
+  checked++;
+
+  // The S-curves must cover the steps of the trapezoid's ramps
+  bool bad = off(b.accelerate_until, path_steps(b, b.acceleration_time, true), 0, 2)
+          || off(b.step_event_count, path_steps(b, 1e12, true), 0, 2);
+
+  // The ISR holds each rate for a whole interrupt, so a ramp only comes out
+  // right if it lasts 20 or more interrupts at its slowest rate. Shorter ones
+  // are left to the sums above, for the trapezoid as well as the S-curve.
+  const bool accel_resolved = b.accelerate_until > 20 && (b.cruise_rate - b.initial_rate) > 20 * accel / b.initial_rate,
+             decel_resolved = b.step_event_count - b.decelerate_after > 20 && (b.cruise_rate - b.final_rate) > 20 * accel / b.final_rate;
+
+  // Cumulative step counts of the ISR against the path it follows, and end
+  // speeds, where each step event can change the rate by accel / rate
+  bad |= curve.steps != b.step_event_count;
+  if ((accel_resolved || !b.accelerate_until) && (decel_resolved || b.decelerate_after == b.step_event_count))
+    bad |= off(b.step_event_count - 1, path_steps(b, curve.end_ticks, true), fabs(b.step_event_count - 1 - path_steps(b, linear.end_ticks, false)), 2);
+  if (decel_resolved)
+    bad |= off(b.final_rate, curve.last_rate, fabs((double)linear.last_rate - b.final_rate), accel / b.final_rate);
+  // Above 10000 steps/s the ISR steps two or four at a time, so the ramp
+  // ends up to two interrupts' worth of steps either side
+  uint8_t cruise_loops;
+  calc_timer(b.cruise_rate, cruise_loops);
+  if (accel_resolved)
+    bad |= off(b.accelerate_until - 1, path_steps(b, curve.accel_end_ticks, true), fabs(b.accelerate_until - 1 - path_steps(b, linear.accel_end_ticks, false)), 2 * cruise_loops)
+        || off(b.cruise_rate, curve.accel_end_rate, fabs((double)linear.accel_end_rate - b.cruise_rate), accel / b.cruise_rate);
+
+  if (accel_resolved && linear.peak_accel > 0 && curve.peak_accel / linear.peak_accel > worst_peak)
+    worst_peak = curve.peak_accel / linear.peak_accel;
+
+  if (bad) {
+    failed++;
+    printf("FAIL n%lu i%u c%u f%u a%.0f: path steps %.1f/%.1f at the end, %.1f/%.1f at accel end, rates %u/%u/%u and %u/%u/%u\n",
+      (unsigned long)steps, initial, nominal, final, accel,
+      path_steps(b, linear.end_ticks, false), path_steps(b, curve.end_ticks, true),
+      path_steps(b, linear.accel_end_ticks, false), path_steps(b, curve.accel_end_ticks, true),
+      b.cruise_rate, linear.accel_end_rate, curve.accel_end_rate,
+      b.final_rate, linear.last_rate, curve.last_rate);
+  }
+}
+
+int main() {
+  // Printing and travel moves at 80 steps/mm, 3000 mm/s²
+  check(4000, 120, 4800, 120, 240000);    // Full trapezoid
+  check(400, 120, 12000, 120, 240000);    // Triangle
+  check(2000, 2400, 4800, 1200, 240000);  // Between junctions
+  check(1000, 4800, 4800, 120, 240000);   // Decelerate only
+  check(1000, 120, 4800, 4800, 240000);   // Accelerate only
+  check(16000, 120, 16000, 120, 800000);  // Two step loops
+  check(40000, 120, 32000, 120, 1600000); // Four step loops
+  check(100, 1000, 3000, 1000, 100000);   // Short segment
+  check(12000, 120, 1600, 120, 40000);    // Z
+
+  // A sweep of random blocks
+  srand(1);
+  for (int i = 0; i < 20000; i++) {
+    const uint32_t steps = 20 + rand() % 20000;
+    const float accel = 10000 + rand() % 1000000;
+    const uint16_t nominal = 200 + rand() % 20000;
+    // The planner only links blocks that can reach the next entry speed
+    const float reach_sq = 2 * 0.95 * accel * steps;
+    uint16_t initial = rand() % nominal, final = rand() % nominal;
+    if (sq((float)initial) > sq((float)final) + reach_sq) initial = sqrt(sq((float)final) + reach_sq);
+    if (sq((float)final) > sq((float)initial) + reach_sq) final = sqrt(sq((float)initial) + reach_sq);
+    check(steps, initial, nominal, final, accel);
+  }
+
+  printf("%lu blocks checked, %lu failed\n", checked, failed);
+  printf("Worst error beyond the linear ramps %.2f%%, peak acceleration %.3fx the linear ramps'\n",
+    worst_error * 100, worst_peak);
+  return failed ? 1 : 0;
+}
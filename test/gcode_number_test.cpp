@@ -0,0 +1,162 @@
+/**
+ * Marlin 3D Printer Firmware
+ * Copyright (C) 2016 MarlinFirmware [https://github.com/MarlinFirmware/Marlin]
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * Host test for gcode_number.h
+ *
+ * Every parameter of every line is parsed with parse_float(), parse_long()
+ * and parse_ulong() and compared with strtod(), strtol() and strtoul() on
+ * the same digits. Without arguments a built-in sample of slicer output is
+ * used; pass G-code files to check them as well:
+ *
+ *   g++ -std=gnu++11 -O2 -I.. -o gcode_number_test gcode_number_test.cpp
+ *   ./gcode_number_test [file.gcode ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "gcode_number.h"
+
+static const char * const sample[] = {
+  // Cura
+  "G0 F7200 X105.424 Y93.162 Z0.3",
+  "G1 F1500 X106.237 Y92.522 E0.03864",
+  "G1 X120.5 Y110.25 E12.34567",
+  "G1 F2400 E-6.5",
+  "M104 S210",
+  "M140 S60",
+  "M106 S255",
+  "G92 E0",
+  // Slic3r and PrusaSlicer
+  "G1 Z0.350 F7800.000",
+  "G1 X85.146 Y84.211 F7800.000",
+  "G1 X86.357 Y83.160 E0.06134",
+  "G1 E-2.00000 F2400.00000",
+  "G1 X100.000 Y100.000 E1.234567 F1800",
+  // Simplify3D
+  "G1 X97.919 Y97.919 E22.8418 F1800",
+  "G1 Z0.200 F1002",
+  // Hand written and edge cases
+  "G1 X+10 Y-0.5 Z.25 E-.75",
+  "G1 X 12.5 Y\t-3.25",
+  "G1 X1234567.5 Y0.000001 Z0.123456789",
+  "G4 P4294967295",
+  "M862 S2147483648",
+  "G1 X0.000000000000000000000000000000000000001",
+  "G1 X1.2345678901234567890123456789012345678901234567890",
+  "G1 X00000000000000000000000000000000000000000001.5",
+  "G2 X10 Y10 I5 J0 E1.5 F600",
+  "M204 S3000 T2500",
+  "M92 X80.0 Y80.0 Z4000 E94.4962",
+  NULL
+};
+
+static unsigned long checked, failed;
+
+static void fail(const char *line, const char *what, double expected, double actual) {
+  failed++;
+  printf("FAIL %s: %s expected %.9g got %.9g\n", line, what, expected, actual);
+}
+
+// Copy the sign, digits and fraction of a number, as G-code writes it, so
+// strtod() doesn't read a following 'E' as an exponent
+static void number_text(const char *p, char *out, size_t size) {
+  size_t n = 0;
+  while (*p == ' ' || *p == '\t') p++;
+  if (*p == '-' || *p == '+') out[n++] = *p++;
+  while (n < size - 1 && (NUMERIC(*p) || *p == '.')) out[n++] = *p++;
+  out[n] = '\0';
+}
+
+static void check_value(const char *line, const char *p) {
+  char text[96];
+  number_text(p, text, sizeof(text));
+
+  const char *q = p;
+  const float f = parse_float(q);
+  const float expected = (float)strtod(text, NULL);
+  checked++;
+  if (isnan(f) || fabs(f - expected) > fabs(expected) * 1e-6 + 1e-9)
+    fail(line, "float", expected, f);
+
+  // parse_float() must stop where the number does
+  const char *end = p;
+  while (*end == ' ' || *end == '\t') end++;
+  end += strlen(text);
+  if (q != end) fail(line, "end", end - p, q - p);
+
+  // Integers as the firmware reads them, up to the decimal point
+  char digits[96];
+  strcpy(digits, text);
+  char *dot = strchr(digits, '.');
+  if (dot) *dot = '\0';
+  if (strlen(digits) > 10) return; // Beyond 32 bits either way
+  const long long value = strtoll(digits, NULL, 10);
+  if (value >= INT32_MIN && value <= INT32_MAX && parse_long(p) != value)
+    fail(line, "long", (double)value, parse_long(p));
+  if (value >= -(long long)UINT32_MAX && value <= UINT32_MAX && parse_ulong(p) != (uint32_t)value)
+    fail(line, "ulong", (double)(uint32_t)value, (double)parse_ulong(p));
+}
+
+static void check_line(const char *line) {
+  char buffer[256];
+  strncpy(buffer, line, sizeof(buffer) - 1);
+  buffer[sizeof(buffer) - 1] = '\0';
+  char *comment = strchr(buffer, ';');
+  if (comment) *comment = '\0';
+
+  // Skip the command itself, and lines whose argument is a string
+  const char *p = buffer;
+  while (*p == ' ') p++;
+  if (*p != 'G' && *p != 'M') return;
+  if (*p == 'M' && (!strncmp(p, "M117", 4) || !strncmp(p, "M23", 3) || !strncmp(p, "M28", 3) || !strncmp(p, "M30", 3))) return;
+  for (p++; NUMERIC(*p); p++) { /* code number */ }
+
+  for (; *p; p++)
+    if (*p >= 'A' && *p <= 'Z') check_value(line, p + 1);
+}
+
+static void check_file(const char *name) {
+  FILE *file = fopen(name, "r");
+  if (!file) { perror(name); failed++; return; }
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    check_line(line);
+  }
+  fclose(file);
+}
+
+int main(int argc, char **argv) {
+  for (const char * const *line = sample; *line; line++) check_line(*line);
+  for (int i = 1; i < argc; i++) check_file(argv[i]);
+
+  // Values above LONG_MAX come back unsigned
+  if (parse_ulong("4294967295") != 4294967295UL) fail("4294967295", "ulong", 4294967295.0, parse_ulong("4294967295"));
+  // A long fraction ends up as a number, not 0/0
+  const char *p = "0.000000000000000000000000000000000001";
+  if (isnan(parse_float(p))) fail("0.0...01", "float", 0, NAN);
+
+  printf("%lu values checked, %lu failed\n", checked, failed);
+  return failed ? 1 : 0;
+}
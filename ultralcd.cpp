@@ -1626,7 +1626,7 @@ void kill_screen(const char* lcd_msg) {
           autotune_temp[e]
         #endif
       );
-      enqueue_and_echo_command(cmd);
+      enqueue_and_echo_command_now(cmd);
     }
 
   #endif //PID_AUTOTUNE_MENU
@@ -1910,6 +1910,9 @@ void kill_screen(const char* lcd_msg) {
       MENU_ITEM_EDIT(float52, MSG_VZ_JERK, &planner.max_jerk[Z_AXIS], 0.1, 990);
     #endif
     MENU_ITEM_EDIT(float3, MSG_VE_JERK, &planner.max_jerk[E_AXIS], 1, 990);
+    #if ENABLED(JUNCTION_DEVIATION)
+      MENU_ITEM_EDIT(float43, MSG_JUNCTION_DEVIATION, &planner.junction_deviation_mm, 0.001, 0.5);
+    #endif
 
     //
     // M203 Settings